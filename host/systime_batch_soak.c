@@ -0,0 +1,99 @@
+// systime_batch_soak.c
+
+/*
+    Host soak test of burst timestamps against exact reference.
+
+    For random units of whole burst, number of samples, burst length (0 to 1024 samples,
+    shorter than unsigned period) and last timestamp anywhere in unsigned range, so bursts
+    wrap:
+    - interval and frac are ticks / samples rounded down to 1 / 2^SYSTIME_BATCH_FRAC_BITS
+    - every filled timestamp is first + floor(k * (interval + frac / 2^FRAC_BITS)), both
+      with and without fraction (unrolled path), and the last one is exactly last
+    - timestamps are behind exact rate ticks / samples by less than 1 unit plus k / 2^FRAC_BITS
+
+    Usage: systime_batch_soak [steps [seed]]
+    Returns 0 if all checks passed.
+*/
+
+#include "systime_batch.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define COUNT_MAX 1024
+
+static unsigned long long rng_state = 88172645463325252ULL;
+static unsigned long long failures;
+
+
+
+// xorshift64, deterministic for given seed
+static unsigned long long rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+
+
+static void fail(const char *what, unsigned long long step, unsigned k, unsigned long long value, unsigned long long ref)
+{
+    if(failures++ < 10) printf("  step %llu sample %u: %s %llu/%llu\n", step, k, what, value, ref);
+}
+
+
+
+int main(int argc, char **argv)
+{
+    static unsigned ts[COUNT_MAX];
+    unsigned long long steps = 2000000, i;
+
+    if(argc > 1) steps = strtoull(argv[1], 0, 0);
+    if(argc > 2) rng_state = strtoull(argv[2], 0, 0) | 1;
+
+    for(i = 0; i < steps; i++)
+    {
+        // ticks for samples, log-uniform so short and fractional intervals are frequent
+        unsigned ticks = (unsigned)(rng() >> (rng() % 32 + 33)) + 1;
+        unsigned samples = (unsigned)(rng() % 100000) + 1;
+        unsigned count = (unsigned)(rng() % (COUNT_MAX + 1));
+        unsigned last = (unsigned)rng();
+        unsigned interval, frac, first, k;
+        unsigned long long step;
+
+        interval = systime_batch_interval(ticks, samples, &frac);
+        if(((unsigned long long)interval << SYSTIME_BATCH_FRAC_BITS) + frac !=
+            ((unsigned long long)ticks << SYSTIME_BATCH_FRAC_BITS) / samples)
+            fail("interval", i, 0, interval, ticks / samples);
+
+        // every fourth burst without fraction for exact unrolled path
+        if(i % 4 == 0) frac = 0;
+        step = ((unsigned long long)interval << SYSTIME_BATCH_FRAC_BITS) + frac;
+
+        // burst shorter than unsigned period, so timestamps compare as differences from first
+        if(count * step >> (8 * sizeof(unsigned) + SYSTIME_BATCH_FRAC_BITS))
+            count = (unsigned)((1ULL << (8 * sizeof(unsigned) + SYSTIME_BATCH_FRAC_BITS)) / step);
+
+        first = systime_batch_first(last, count, interval, frac);
+        systime_batch_fill(ts, count, first, interval, frac);
+
+        for(k = 0; k < count; k++)
+        {
+            unsigned ref = first + (unsigned)((k * step) >> SYSTIME_BATCH_FRAC_BITS);
+            // exact time of sample behind first, in 1 / 2^FRAC_BITS units
+            unsigned long long exact = ((unsigned long long)k * ticks << SYSTIME_BATCH_FRAC_BITS) / samples;
+
+            if(ts[k] != ref) fail("timestamp", i, k, ts[k], ref);
+            if(frac && (exact - ((unsigned long long)(ts[k] - first) << SYSTIME_BATCH_FRAC_BITS)) >
+                (1ULL << SYSTIME_BATCH_FRAC_BITS) + k)
+                fail("behind exact rate", i, k, ts[k] - first, exact >> SYSTIME_BATCH_FRAC_BITS);
+        }
+        if(count && ts[count - 1] != last) fail("last", i, count - 1, ts[count - 1], last);
+        if(count == 0 && first != last) fail("empty first", i, 0, first, last);
+    }
+
+    printf("batch soak: %llu steps, %llu failures\n", steps, failures);
+
+    return failures != 0;
+}
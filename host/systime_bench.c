@@ -0,0 +1,174 @@
+// systime_bench.c
+
+/*
+    Host benchmark of systime conversion cost.
+
+    Runs systime on simulated timer (systime_sim.h) with given hw_bits, tick_multiplier
+    and ticks_for_1ms, and for every gap between calls reports cost of one systime_ms()
+    and one systime_sec() call. Conversion path is selected at compile time like on target,
+    make bench builds loop, SYSTEM_TIME_HAVE_DIV_INST and SYSTEM_TIME_USE_RECIPROCAL
+    versions of this file.
+
+    Built without SYSTIME_STATS it reports ns per call (and TSC cycles on x86) including
+    one simulated timer advance, and timer reads per call. Built with SYSTIME_STATS it
+    reports iterations of conversion loops per call instead, timing would include counters.
+
+    systime_sec() is compared with legacy_sec(), conversion of systime_sec() before it
+    sampled time once per call (systime_ms() in loop condition).
+
+    Usage: systime_bench [hw_bits tick_multiplier ticks_for_1ms [calls]]
+    default is 32-bit timer at 1MHz.
+*/
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "systime_sim.h"
+#include "systime_stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC
+#endif // __x86_64__
+
+// gaps between calls in ms
+static const unsigned gaps_ms[] = { 0, 1, 10, 100, 1000, 10000, 60000 };
+
+static volatile unsigned sink;
+static unsigned legacy_last_ms, legacy_curr_sec;
+
+
+
+// systime_sec() before it sampled systime_ms() once per call
+static unsigned legacy_sec(void)
+{
+#if defined(SYSTEM_TIME_HAVE_DIV_INST)
+    unsigned diff = (systime_ms() - legacy_last_ms) / 1000U;
+    legacy_curr_sec += diff;
+    legacy_last_ms += diff * 1000;
+#else
+    while((systime_ms() - legacy_last_ms) >= 1000)
+    {
+        legacy_last_ms += 1000;
+        legacy_curr_sec++;
+    }
+#endif  // SYSTEM_TIME_HAVE_DIV_INST
+
+    return legacy_curr_sec;
+}
+
+
+
+static unsigned long long now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+}
+
+
+
+static unsigned long long now_cycles(void)
+{
+#if defined(HAVE_TSC)
+    return __rdtsc();
+#else
+    return 0;
+#endif // HAVE_TSC
+}
+
+
+
+// calls fcn calls times with gap timer ticks before every call and prints its cost
+static void run(const char *name, unsigned (*fcn)(void), unsigned gap_ms, unsigned long long gap, unsigned calls)
+{
+    unsigned long reads;
+    unsigned long long ns, cycles;
+    unsigned i;
+
+    // catch up, so every measured call converts one gap
+    fcn();
+    systime_stats_reset();
+    reads = systime_sim_reads;
+
+    ns = now_ns();
+    cycles = now_cycles();
+    for(i = 0; i < calls; i++)
+    {
+        systime_sim_advance(gap);
+        sink = fcn();
+    }
+    cycles = now_cycles() - cycles;
+    ns = now_ns() - ns;
+
+    printf("%-12s gap %6u ms  %7.1f reads/call", name, gap_ms, (double)(systime_sim_reads - reads) / calls);
+#if defined(SYSTIME_STATS)
+    (void)cycles;
+    (void)ns;
+    printf("  %9.1f ms loops/call  %7.1f sec loops/call  %7.1f ms calls/call\n",
+        (double)systime_stats.conv_loops / calls, (double)systime_stats.sec_loops / calls,
+        (double)systime_stats.ms_calls / calls);
+#else
+    printf("  %9.1f ns/call", (double)ns / calls);
+#if defined(HAVE_TSC)
+    printf("  %10.1f cycles/call", (double)cycles / calls);
+#endif // HAVE_TSC
+    printf("\n");
+#endif // SYSTIME_STATS
+}
+
+
+
+int main(int argc, char **argv)
+{
+    unsigned hw_bits = 32, mult = 1, ticks1ms = 1000, calls = 100000;
+    unsigned long long period;
+    unsigned i;
+
+    if(argc > 3)
+    {
+        hw_bits = (unsigned)strtoul(argv[1], 0, 0);
+        mult = (unsigned)strtoul(argv[2], 0, 0);
+        ticks1ms = (unsigned)strtoul(argv[3], 0, 0);
+    }
+    if(argc > 4) calls = (unsigned)strtoul(argv[4], 0, 0);
+
+    printf("conversion %s, hw_bits %u tick_multiplier %u ticks_for_1ms %u\n",
+#if defined(SYSTEM_TIME_HAVE_DIV_INST)
+        "SYSTEM_TIME_HAVE_DIV_INST",
+#elif defined(SYSTEM_TIME_USE_RECIPROCAL)
+        "SYSTEM_TIME_USE_RECIPROCAL",
+#else
+        "loops",
+#endif // SYSTEM_TIME_HAVE_DIV_INST
+        hw_bits, mult, ticks1ms);
+
+    systime_sim_init(hw_bits, mult, ticks1ms);
+    legacy_last_ms = systime_ms();
+    legacy_curr_sec = 0;
+
+    // systime must be called at least once in timer full period
+    period = 1ULL << hw_bits;
+
+    for(i = 0; i < sizeof(gaps_ms) / sizeof(gaps_ms[0]); i++)
+    {
+        // timer ticks for gap, 1 tick for gap 0
+        unsigned long long gap = (unsigned long long)gaps_ms[i] * ticks1ms / mult;
+        unsigned n = calls;
+
+        if(gap == 0) gap = 1;
+        if(gap >= period) continue;
+
+        // one run is less than quarter of ms period, so catch-up of next run is exact
+        if(gaps_ms[i] && n > (1U << 30) / gaps_ms[i]) n = (1U << 30) / gaps_ms[i];
+
+        run("systime_ms", systime_ms, gaps_ms[i], gap, n);
+        run("systime_sec", systime_sec, gaps_ms[i], gap, n);
+        run("legacy_sec", legacy_sec, gaps_ms[i], gap, n);
+    }
+
+    return 0;
+}
@@ -0,0 +1,126 @@
+// systime_bucket_soak.c
+
+/*
+    Host soak test of token bucket against exact reference count of tokens.
+
+    Time base runs on simulated 32-bit timer with fractional rate of 11059.2 ticks for
+    1 ms, so ticks for one token are never whole. For 3, 7, 10 and 1000 tokens per second
+    bucket is drained after every random gap, tokens taken since init must be exactly
+    burst plus tokens due by reference time, k-th token is due at floor(k * ticks per
+    token). Gaps stay below time to fill whole bucket, so it never gets full and loses
+    time, and they wrap 32-bit systime_tick() many times.
+
+    After random gaps bucket idle longer than its fill time must be exactly full.
+
+    Usage: systime_bucket_soak [steps [seed]]
+    Returns 0 if all checks passed.
+*/
+
+#include "systime_bucket.h"
+#include "systime_sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BURST 20
+// 11059.2 ticks for 1 ms
+#define RATE_NUM 110592U
+#define RATE_DEN 10U
+
+static unsigned long long rng_state = 88172645463325252ULL;
+static unsigned long long failures;
+
+
+
+// xorshift64, deterministic for given seed
+static unsigned long long rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+
+
+static void fail(unsigned rate, unsigned long long step, const char *what, unsigned long long value, unsigned long long ref)
+{
+    if(failures++ < 10) printf("  rate %u step %llu: %s %llu/%llu\n", rate, step, what, value, ref);
+}
+
+
+
+// returns number of tokens due in ticks since init, k-th is due at floor(k * num / den)
+static unsigned long long ref_tokens(unsigned long long ticks, unsigned rate)
+{
+    unsigned long long num = RATE_NUM * 1000ULL;
+    unsigned long long den = (unsigned long long)RATE_DEN * rate;
+
+    return ((ticks + 1) * den - 1) / num;
+}
+
+
+
+// take all available tokens, sometimes two at once, returns their number
+static unsigned long long drain(struct systime_bucket *bucket)
+{
+    unsigned long long n = 0;
+
+    if(rng() & 1)
+    {
+        while(systime_bucket_take_n(bucket, 2)) n += 2;
+    }
+    while(systime_bucket_take(bucket)) n++;
+
+    return n;
+}
+
+
+
+static void soak(unsigned rate, unsigned long long steps)
+{
+    struct systime_bucket bucket;
+    // whole ticks of fewer tokens than burst, so bucket never fills between drains
+    unsigned long long gap_max = (BURST - 2) * (RATE_NUM * 1000ULL / (RATE_DEN * rate));
+    unsigned long long start, taken, i;
+
+    systime_bucket_init(&bucket, BURST, rate);
+    start = systime_sim_ref_ticks();
+    taken = drain(&bucket);
+    if(taken != BURST) fail(rate, 0, "full bucket", taken, BURST);
+
+    for(i = 1; i <= steps; i++)
+    {
+        unsigned long long ref;
+
+        systime_sim_advance(rng() % gap_max);
+        taken += drain(&bucket);
+        ref = BURST + ref_tokens(systime_sim_ref_ticks() - start, rate);
+        if(taken != ref) fail(rate, i, "taken", taken, ref);
+        if(systime_bucket_tokens(&bucket) != 0) fail(rate, i, "tokens after drain", systime_bucket_tokens(&bucket), 0);
+    }
+
+    // idle longer than fill time
+    systime_sim_advance(2 * gap_max);
+    if(systime_bucket_tokens(&bucket) != BURST) fail(rate, i, "idle bucket", systime_bucket_tokens(&bucket), BURST);
+}
+
+
+
+int main(int argc, char **argv)
+{
+    static const unsigned rates[] = { 3, 7, 10, 1000 };
+    unsigned long long steps = 200000;
+    unsigned i;
+
+    if(argc > 1) steps = strtoull(argv[1], 0, 0);
+    if(argc > 2) rng_state = strtoull(argv[2], 0, 0) | 1;
+
+    systime_sim_init(32, 1, RATE_NUM / RATE_DEN);
+    systime_time_init_frac(RATE_NUM, RATE_DEN);
+
+    for(i = 0; i < sizeof(rates) / sizeof(rates[0]); i++) soak(rates[i], steps);
+
+    printf("bucket soak: %llu steps, %llu failures\n", steps, failures);
+
+    return failures != 0;
+}
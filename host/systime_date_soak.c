@@ -0,0 +1,132 @@
+// systime_date_soak.c
+
+/*
+    Host soak test of calendar dates against gmtime() of host C library.
+
+    Over whole unsigned range of seconds since 1970-01-01 (years 1970 to 2106):
+    - every day: last second of day and first second of next day, updated incrementally
+      from the day before, must match gmtime() in all fields including day of week
+    - random times: full conversion must match gmtime(), systime_date_to_sec() must return
+      the same time and systime_date_format() must be strftime() "%Y-%m-%d %H:%M:%S"
+    - walk: date updated by random steps from 0 to 3 days, sometimes backward, must match
+      gmtime() after every step, also when time wraps over full unsigned range
+
+    Host time_t must be 64 bits.
+
+    Usage: systime_date_soak [steps [seed]]
+    Returns 0 if all checks passed.
+*/
+
+#include "systime_date.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define SEC_DAY 86400U
+
+static unsigned long long rng_state = 88172645463325252ULL;
+static unsigned long long failures;
+
+
+
+// xorshift64, deterministic for given seed
+static unsigned long long rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+
+
+// compare date with gmtime() of time, returns nonzero on mismatch
+static int check(const char *phase, const struct systime_date *date, unsigned time)
+{
+    time_t t = (time_t)time;
+    const struct tm *tm = gmtime(&t);
+
+    if(tm && date->time == time && date->year == tm->tm_year + 1900 && date->month == tm->tm_mon + 1 &&
+        date->day == tm->tm_mday && date->hour == tm->tm_hour && date->min == tm->tm_min &&
+        date->sec == tm->tm_sec && date->wday == tm->tm_wday) return 0;
+
+    if(failures++ < 10)
+    {
+        printf("  %s time %u: %04u-%02u-%02u %02u:%02u:%02u wday %u", phase, time, date->year, date->month,
+            date->day, date->hour, date->min, date->sec, date->wday);
+        if(tm) printf(", gmtime %04d-%02d-%02d %02d:%02d:%02d wday %d", tm->tm_year + 1900, tm->tm_mon + 1,
+            tm->tm_mday, tm->tm_hour, tm->tm_min, tm->tm_sec, tm->tm_wday);
+        printf("\n");
+    }
+    return 1;
+}
+
+
+
+int main(int argc, char **argv)
+{
+    unsigned long long steps = 2000000, i;
+    struct systime_date date, walk;
+    unsigned time;
+
+    if(argc > 1) steps = strtoull(argv[1], 0, 0);
+    if(argc > 2) rng_state = strtoull(argv[2], 0, 0) | 1;
+
+    if(sizeof(time_t) < 8)
+    {
+        printf("date soak needs 64-bit time_t\n");
+        return 2;
+    }
+
+    // zeroed date is fully converted by update
+    memset(&date, 0, sizeof(date));
+    systime_date_update(&date, 0);
+    check("zero", &date, 0);
+
+    // every day boundary, incrementally from previous day
+    for(time = SEC_DAY - 1; time >= SEC_DAY - 1; time += SEC_DAY)
+    {
+        systime_date_update(&date, time);
+        check("day end", &date, time);
+        if(time == ~0U) break;
+        systime_date_update(&date, time + 1);
+        check("day start", &date, time + 1);
+    }
+
+    // random times, full conversion, round trip and format
+    for(i = 0; i < steps; i++)
+    {
+        char buf[SYSTIME_DATE_LEN], ref[32];
+        time_t t;
+
+        time = (unsigned)rng();
+        systime_date_from_sec(&date, time);
+        if(check("random", &date, time)) continue;
+
+        if(systime_date_to_sec(&date) != time && failures++ < 10)
+            printf("  to_sec time %u: %u\n", time, systime_date_to_sec(&date));
+
+        t = (time_t)time;
+        strftime(ref, sizeof(ref), "%Y-%m-%d %H:%M:%S", gmtime(&t));
+        if((systime_date_format(buf, &date) != strlen(ref) || strcmp(buf, ref)) && failures++ < 10)
+            printf("  format time %u: %s/%s\n", time, buf, ref);
+    }
+
+    // random steps forward, sometimes backward, wrapping over unsigned range
+    time = (unsigned)rng();
+    systime_date_from_sec(&walk, time);
+    for(i = 0; i < steps; i++)
+    {
+        unsigned step = rng() % 4 == 0 ? (unsigned)(rng() % SEC_DAY) : (unsigned)(rng() % (3 * SEC_DAY));
+
+        if(rng() % 64 == 0) time -= step;
+        else time += step;
+        systime_date_update(&walk, time);
+        check("walk", &walk, time);
+    }
+
+    printf("date soak: %llu steps, %llu failures\n", steps, failures);
+
+    return failures != 0;
+}
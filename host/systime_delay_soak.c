@@ -0,0 +1,151 @@
+// systime_delay_soak.c
+
+/*
+    Host soak test of busy-wait delays against simulated time.
+
+    Timer is simulated 32-bit counter that advances by random 1 to STEP_MAX ticks at every
+    read, so systime_tick() has cost and jitter like on target. Delays that wait on
+    systime_tick() (at least SYSTIME_DELAY_SHORT_MULT overheads) must last at least
+    requested ticks, ms or us rounded up to whole ticks, and at most one tick and two
+    reads more for every WAIT_MAX chunk. Short delays spin calibrated loop, which takes no
+    simulated time, so they are not checked here.
+
+    Every check runs at fractional rate of 11059.2 ticks for 1 ms and then at 72000 ticks
+    for 1 ms set later like by calibration, with systime_delay_init() called again, so ms
+    and us delays must follow new rate. Then long delays over WAIT_MAX ticks run with
+    bigger timer steps.
+
+    Usage: systime_delay_soak [steps [seed]]
+    Returns 0 if all checks passed.
+*/
+
+#include "systime_delay.h"
+#include "systime_tick.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// largest timer advance between two reads
+#define STEP_MAX 64
+// WAIT_MAX of systime_delay.c
+#define WAIT_MAX (1ULL << (8 * sizeof(unsigned) - 2))
+
+static unsigned long long rng_state = 88172645463325252ULL;
+static unsigned long long failures;
+// simulated ticks and size of timer steps
+static unsigned long long sim_now;
+static unsigned sim_step_max = STEP_MAX;
+
+
+
+// xorshift64, deterministic for given seed
+static unsigned long long rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+
+
+// timer that advances on every read
+static unsigned sim_read(void)
+{
+    unsigned now = (unsigned)sim_now;
+
+    sim_now += 1 + rng() % sim_step_max;
+    return now;
+}
+
+
+
+static void fail(const char *what, unsigned long long step, unsigned long long elapsed, unsigned long long ref)
+{
+    if(failures++ < 10) printf("  %s step %llu: elapsed %llu ticks, requested %llu\n", what, step, elapsed, ref);
+}
+
+
+
+// check elapsed ticks of delay that was requested for ref ticks
+static void check(const char *what, unsigned long long step, unsigned long long start, unsigned long long ref)
+{
+    unsigned long long elapsed = sim_now - start;
+    unsigned long long chunks = ref / WAIT_MAX + 1;
+
+    if(elapsed < ref || elapsed > ref + chunks * (1 + 2ULL * sim_step_max)) fail(what, step, elapsed, ref);
+}
+
+
+
+// delays of random length at ticks_for_1ms num / den, from shortest delay that waits on timer
+static void soak(unsigned num, unsigned den, unsigned long long steps)
+{
+    unsigned long long i, start, ref;
+    // ticks below this may spin, overhead is at most STEP_MAX
+    unsigned long long wait_min = SYSTIME_DELAY_SHORT_MULT * (STEP_MAX + 1);
+
+    systime_time_init_frac(num, den);
+    systime_delay_init();
+
+    for(i = 0; i < steps; i++)
+    {
+        unsigned ticks = (unsigned)(wait_min + rng() % 20000);
+        unsigned ms = (unsigned)(rng() % 5);
+        unsigned us = (unsigned)(rng() % 5000);
+
+        start = sim_now;
+        systime_delay_ticks(ticks);
+        check("ticks", i, start, ticks);
+
+        // ms and us rounded up to whole ticks
+        ref = ((unsigned long long)ms * num + den - 1) / den;
+        if(ref >= wait_min)
+        {
+            start = sim_now;
+            systime_delay_ms(ms);
+            check("ms", i, start, ref);
+        }
+
+        ref = ((unsigned long long)us * num + den * 1000ULL - 1) / (den * 1000ULL);
+        if(ref >= wait_min)
+        {
+            start = sim_now;
+            systime_delay_us(us);
+            // us rate is rounded up to 1 / 2^16 tick
+            check("us", i, start, ref);
+            if(sim_now - start > ref + 2 + 2ULL * sim_step_max + (us >> 16)) fail("us too long", i, sim_now - start, ref);
+        }
+    }
+}
+
+
+
+int main(int argc, char **argv)
+{
+    unsigned long long steps = 20000, i, start, ref;
+
+    if(argc > 1) steps = strtoull(argv[1], 0, 0);
+    if(argc > 2) rng_state = strtoull(argv[2], 0, 0) | 1;
+
+    systime_tick_init(sim_read, 32, 1);
+
+    soak(110592, 10, steps);
+    // new rate like after calibration, delays are initialized again
+    soak(72000, 1, steps);
+
+    // longer than WAIT_MAX, waited in chunks, timer steps are bigger so it doesn't take long
+    sim_step_max = 1U << 16;
+    for(i = 0; i < 10; i++)
+    {
+        unsigned ms = 15000 + (unsigned)(rng() % 100000);
+
+        ref = (unsigned long long)ms * 72000U;
+        start = sim_now;
+        systime_delay_ms(ms);
+        check("long ms", i, start, ref);
+    }
+
+    printf("delay soak: %llu steps, %llu failures\n", steps, failures);
+
+    return failures != 0;
+}
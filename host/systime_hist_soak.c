@@ -0,0 +1,137 @@
+// systime_hist_soak.c
+
+/*
+    Host test of latency histogram buckets and percentiles against exact reference.
+
+    Every bucket: systime_hist_index() of systime_hist_low() is the bucket itself and value
+    one below it is in previous bucket, so buckets cover whole unsigned range without gap
+    or overlap, and last bucket ends at ~0. Random values: value is between low of its
+    bucket and low of next one, and bucket is at most 1 / 2^SYSTIME_HIST_SUB_BITS of it.
+
+    Then log-uniform random samples are added to two histograms and their merged snapshot
+    is checked against sorted reference samples: total, max, and for random ppm
+    percentile is in the same bucket as reference sample of that rank, at or above it and
+    at most max.
+
+    Usage: systime_hist_soak [samples [seed]]
+    Returns 0 if all checks passed.
+*/
+
+#include "systime_hist.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static unsigned long long rng_state = 88172645463325252ULL;
+static unsigned long long failures;
+
+static struct systime_hist hist_a, hist_b, snap;
+
+
+
+// xorshift64, deterministic for given seed
+static unsigned long long rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+
+
+static void fail(const char *what, unsigned long long a, unsigned long long b)
+{
+    if(failures++ < 10) printf("  %s: %llu/%llu\n", what, a, b);
+}
+
+
+
+// log-uniform random value over whole unsigned range
+static unsigned random_value(void)
+{
+    unsigned bits = (unsigned)(rng() % (8 * sizeof(unsigned))) + 1;
+    return (unsigned)(rng() & (~0ULL >> (64 - bits)));
+}
+
+
+
+static int cmp_unsigned(const void *a, const void *b)
+{
+    unsigned x = *(const unsigned *)a, y = *(const unsigned *)b;
+    return x < y ? -1 : x > y;
+}
+
+
+
+int main(int argc, char **argv)
+{
+    // edges and p99 first, then random ranks
+    static const unsigned fixed_ppm[] = { 0, 1, 500000, 990000, 999999, 1000000 };
+    unsigned long long samples = 2000000, i;
+    unsigned *ref, max = 0, index;
+
+    if(argc > 1) samples = strtoull(argv[1], 0, 0);
+    if(argc > 2) rng_state = strtoull(argv[2], 0, 0) | 1;
+
+    // buckets round-trip and cover unsigned range
+    if(systime_hist_low(0) != 0) fail("low of first bucket", systime_hist_low(0), 0);
+    if(systime_hist_index(~0U) != SYSTIME_HIST_BUCKETS - 1) fail("bucket of ~0", systime_hist_index(~0U), SYSTIME_HIST_BUCKETS - 1);
+    for(index = 1; index < SYSTIME_HIST_BUCKETS; index++)
+    {
+        unsigned low = systime_hist_low(index);
+
+        if(systime_hist_index(low) != index) fail("bucket of low", systime_hist_index(low), index);
+        if(systime_hist_index(low - 1) != index - 1) fail("bucket below low", systime_hist_index(low - 1), index - 1);
+    }
+
+    for(i = 0; i < samples; i++)
+    {
+        unsigned v = random_value();
+        unsigned long long low, next;
+
+        index = systime_hist_index(v);
+        low = systime_hist_low(index);
+        next = index + 1 < SYSTIME_HIST_BUCKETS ? systime_hist_low(index + 1) : 1ULL << (8 * sizeof(unsigned));
+        if(v < low || v >= next) fail("value outside its bucket", v, low);
+        if(v >= SYSTIME_HIST_SUB && (next - low) << SYSTIME_HIST_SUB_BITS > v) fail("bucket too wide", next - low, v);
+    }
+
+    // percentiles of merged snapshot against sorted samples
+    ref = malloc(samples * sizeof(*ref));
+    if(!ref)
+    {
+        printf("out of memory\n");
+        return 2;
+    }
+
+    systime_hist_reset(&hist_a);
+    systime_hist_reset(&hist_b);
+    for(i = 0; i < samples; i++)
+    {
+        ref[i] = random_value();
+        if(ref[i] > max) max = ref[i];
+        systime_hist_add(i & 1 ? &hist_a : &hist_b, ref[i]);
+    }
+    qsort(ref, samples, sizeof(*ref), cmp_unsigned);
+
+    systime_hist_snapshot(&snap, &hist_a);
+    systime_hist_merge(&snap, &hist_b);
+    if(systime_hist_total(&snap) != samples) fail("total", systime_hist_total(&snap), samples);
+    if(snap.max != max) fail("max", snap.max, max);
+
+    for(i = 0; i < 100000 && samples; i++)
+    {
+        unsigned ppm = i < sizeof(fixed_ppm) / sizeof(fixed_ppm[0]) ? fixed_ppm[i] : (unsigned)(rng() % 1000001);
+        unsigned long long rank = (samples * ppm + 999999) / 1000000;
+        unsigned p = systime_hist_percentile(&snap, ppm);
+        unsigned r = ref[(rank ? rank : 1) - 1];
+
+        if(systime_hist_index(p) != systime_hist_index(r) || p < r || p > max) fail("percentile", p, r);
+    }
+
+    free(ref);
+
+    printf("hist soak: %llu samples, %llu failures\n", samples, failures);
+
+    return failures != 0;
+}
@@ -0,0 +1,140 @@
+// systime_poll_soak.c
+
+/*
+    Host soak test of polling timeouts against simulated time.
+
+    Every poll runs loop whose iteration takes random c to 2c simulated ticks, or c ticks
+    that double once at random iteration, c is random for every poll from 1 to 2^12 ticks,
+    time advances only there. Timeout must never be
+    detected early, at most slack or one iteration late, and timer must be read at most
+    few times per slack: 4 * timeout / slack plus 100 for ramp up of stride and denser
+    checks near timeout.
+
+    Timeouts are set in ticks with random slack, in ms and in us with default slack, first
+    at fractional rate of 11059.2 ticks for 1 ms and then at 72000 ticks for 1 ms set later
+    like by calibration, polls started after it must use new rate.
+
+    Usage: systime_poll_soak [steps [seed]]
+    Returns 0 if all checks passed.
+*/
+
+#include "systime_poll.h"
+#include "systime_sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// iterations of one poll are up to about this
+#define ITER_MAX (1U << 14)
+
+static unsigned long long rng_state = 88172645463325252ULL;
+static unsigned long long failures;
+
+
+
+// xorshift64, deterministic for given seed
+static unsigned long long rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+
+
+static void fail(const char *what, unsigned long long step, unsigned long long value, unsigned long long ref)
+{
+    if(failures++ < 10) printf("  step %llu: %s %llu/%llu\n", step, what, value, ref);
+}
+
+
+
+// log-uniform random number from 1 to 2^bits
+static unsigned long long random_log(unsigned bits)
+{
+    unsigned b = (unsigned)(rng() % (bits + 1));
+    return (rng() & ((1ULL << b) - 1)) + 1;
+}
+
+
+
+// run started poll with iterations of c to 2c ticks, check it against timeout and slack ticks
+static void run(unsigned long long step, struct systime_poll *poll, unsigned long long c,
+    unsigned long long timeout, unsigned long long slack)
+{
+    // simulated time didn't move since poll was started
+    unsigned long long start = systime_sim_ref_ticks();
+    unsigned long reads = systime_sim_reads;
+    unsigned long long elapsed, late;
+    // iteration where constant cost doubles, else cost is random
+    unsigned long long iter = 0, doubling = rng() & 1 ? rng() % (timeout / c + 1) : ~0ULL;
+
+    do
+    {
+        if(doubling == ~0ULL) systime_sim_advance(c + rng() % c);
+        else systime_sim_advance(iter++ < doubling ? c : 2 * c);
+    }
+    while(!systime_poll_expired(poll));
+
+    elapsed = systime_sim_ref_ticks() - start;
+    reads = systime_sim_reads - reads;
+    late = slack > 2 * c ? slack : 2 * c;
+
+    if(elapsed < timeout) fail("early", step, elapsed, timeout);
+    else if(elapsed - timeout > late) fail("late", step, elapsed - timeout, late);
+    if(reads > 4 * timeout / slack + 100) fail("reads", step, reads, 4 * timeout / slack + 100);
+    if(!systime_poll_expired(poll)) fail("not expired again", step, 0, 0);
+}
+
+
+
+static void soak(unsigned num, unsigned den, unsigned long long steps)
+{
+    struct systime_poll poll;
+    unsigned long long i;
+
+    systime_time_init_frac(num, den);
+
+    for(i = 0; i < steps; i++)
+    {
+        unsigned long long c = random_log(12);
+        unsigned long long timeout = random_log(14) * c;
+        unsigned long long slack = random_log(34) % timeout + 1;
+        unsigned ms = (unsigned)(rng() % 20);
+        unsigned us = (unsigned)(rng() % 20000);
+
+        systime_poll_start(&poll, timeout, (unsigned)slack);
+        run(i, &poll, c, timeout, slack);
+
+        // ms and us timeouts rounded up to whole ticks, their iterations are limited too
+        timeout = ((unsigned long long)ms * num + den - 1) / den;
+        c = timeout / ITER_MAX + 1;
+        systime_poll_start_ms(&poll, ms);
+        run(i, &poll, c, timeout, timeout / SYSTIME_POLL_SLACK_DIV ? timeout / SYSTIME_POLL_SLACK_DIV : 1);
+
+        timeout = ((unsigned long long)us * num + den * 1000ULL - 1) / (den * 1000ULL);
+        c = timeout / ITER_MAX + 1;
+        systime_poll_start_us(&poll, us);
+        run(i, &poll, c, timeout, timeout / SYSTIME_POLL_SLACK_DIV ? timeout / SYSTIME_POLL_SLACK_DIV : 1);
+    }
+}
+
+
+
+int main(int argc, char **argv)
+{
+    unsigned long long steps = 20000;
+
+    if(argc > 1) steps = strtoull(argv[1], 0, 0);
+    if(argc > 2) rng_state = strtoull(argv[2], 0, 0) | 1;
+
+    systime_sim_init(32, 1, 11059);
+
+    soak(110592, 10, steps);
+    // new rate like after calibration, polls are started again
+    soak(72000, 1, steps);
+
+    printf("poll soak: %llu steps, %llu failures\n", steps, failures);
+
+    return failures != 0;
+}
@@ -0,0 +1,228 @@
+// systime_sched_soak.c
+
+/*
+    Host soak test of scheduler against reference model of its tasks.
+
+    Scheduler runs on simulated time function. Random periodic and one-shot tasks are
+    added, restarted and canceled, time jumps by random gaps up to 2^20 units, and task
+    functions take random time and sometimes add or cancel tasks, themselves too.
+
+    Every dispatched task must be due and no other scheduled task may have earlier
+    deadline. Lateness is measured at dispatch, after functions of earlier tasks, so
+    late_max, skipped overruns and next deadline of periodic task must match reference
+    computed from time in its function. After every run no task that was due at its
+    start is left, and systime_sched_next() before run is exact distance to earliest
+    reference deadline.
+
+    Usage: systime_sched_soak [steps [seed]]
+    Returns 0 if all checks passed.
+*/
+
+#include "systime_sched.h"
+#include "systime_serial.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TASKS 32
+
+static unsigned long long rng_state = 88172645463325252ULL;
+static unsigned long long failures;
+static unsigned long long step;
+static unsigned sim_now = 0xFFF00000U;
+
+static struct systime_sched sched;
+static struct systime_task *heap[TASKS];
+static struct systime_task tasks[TASKS];
+
+// reference state of every task
+static struct
+{
+    int scheduled;
+    // added by task function of current run, it can still be due after run
+    int added_in_run;
+    unsigned deadline;
+    unsigned period;
+    unsigned overruns;
+    unsigned late_max;
+} ref[TASKS];
+
+static int in_run;
+
+
+
+// xorshift64, deterministic for given seed
+static unsigned long long rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+
+
+static unsigned now_fcn(void)
+{
+    return sim_now;
+}
+
+
+
+static void fail(const char *what, unsigned id, unsigned long long value, unsigned long long expected)
+{
+    if(failures++ < 10) printf("  step %llu task %u now %u: %s %llu/%llu\n", step, id, sim_now, what, value, expected);
+}
+
+
+
+// log-uniform random number up to 2^bits - 1
+static unsigned random_gap(unsigned bits)
+{
+    unsigned b = (unsigned)(rng() % (bits + 1));
+    return (unsigned)(rng() & ((1ULL << b) - 1));
+}
+
+
+
+static void task_add(unsigned id)
+{
+    unsigned delay = random_gap(24);
+    unsigned period = rng() % 4 ? random_gap(22) + 1 : 0;
+
+    if(!systime_sched_add(&sched, &tasks[id], delay, period)) fail("add refused", id, 0, 1);
+    ref[id].scheduled = 1;
+    ref[id].added_in_run = in_run;
+    ref[id].deadline = sim_now + delay;
+    ref[id].period = period;
+}
+
+
+
+static void task_cancel(unsigned id)
+{
+    systime_sched_cancel(&sched, &tasks[id]);
+    ref[id].scheduled = 0;
+}
+
+
+
+static void task_fcn(struct systime_task *task, void *arg)
+{
+    unsigned id = (unsigned)(task - tasks), i;
+    unsigned late = sim_now - ref[id].deadline;
+
+    (void)arg;
+
+    // dispatched task is due and earliest of all
+    if(!ref[id].scheduled) fail("run but not scheduled", id, 0, 1);
+    if(systime_before(sim_now, ref[id].deadline)) fail("run before deadline", id, ref[id].deadline, sim_now);
+    for(i = 0; i < TASKS; i++)
+    {
+        if(ref[i].scheduled && systime_before(ref[i].deadline, ref[id].deadline))
+            fail("earlier task not run first", i, ref[i].deadline, ref[id].deadline);
+    }
+
+    // lateness at dispatch, whole missed periods are skipped
+    if(late > ref[id].late_max) ref[id].late_max = late;
+    if(ref[id].period)
+    {
+        ref[id].overruns += late / ref[id].period;
+        ref[id].deadline += (late / ref[id].period + 1) * ref[id].period;
+        if(task->deadline != ref[id].deadline) fail("next deadline", id, task->deadline, ref[id].deadline);
+        if(!systime_task_scheduled(task)) fail("periodic task not scheduled", id, 0, 1);
+    }
+    else
+    {
+        ref[id].scheduled = 0;
+        if(systime_task_scheduled(task)) fail("one-shot task still scheduled", id, 1, 0);
+    }
+    if(task->late_max != ref[id].late_max) fail("late_max", id, task->late_max, ref[id].late_max);
+    if(task->overruns != ref[id].overruns) fail("overruns", id, task->overruns, ref[id].overruns);
+
+    // function takes time, so later tasks of the same run are dispatched later
+    sim_now += 1 + random_gap(12);
+
+    // sometimes add or cancel tasks, also itself
+    switch(rng() % 8)
+    {
+    case 0: task_add(id); break;
+    case 1: task_cancel(id); break;
+    case 2: task_add((unsigned)(rng() % TASKS)); break;
+    case 3: task_cancel((unsigned)(rng() % TASKS)); break;
+    default: break;
+    }
+}
+
+
+
+// returns reference distance to earliest deadline like systime_sched_next()
+static unsigned ref_next(void)
+{
+    unsigned min = SYSTIME_SCHED_NONE, i;
+
+    for(i = 0; i < TASKS; i++)
+    {
+        if(!ref[i].scheduled) continue;
+        if(!systime_before(sim_now, ref[i].deadline)) return 0;
+        if(ref[i].deadline - sim_now < min) min = ref[i].deadline - sim_now;
+    }
+
+    return min;
+}
+
+
+
+static void run_check(void)
+{
+    unsigned start = sim_now, i;
+
+    if(systime_sched_next(&sched) != ref_next()) fail("next differs from reference", 0, systime_sched_next(&sched), ref_next());
+
+    in_run = 1;
+    if(systime_sched_run(&sched) != ref_next()) fail("run returned other than reference next", 0, 0, ref_next());
+    in_run = 0;
+
+    for(i = 0; i < TASKS; i++)
+    {
+        if(ref[i].scheduled && !ref[i].added_in_run && !systime_before(start, ref[i].deadline))
+        {
+            fail("due but not run", i, ref[i].deadline, start);
+            task_cancel(i);
+        }
+        if(ref[i].scheduled != systime_task_scheduled(&tasks[i])) fail("scheduled differs from reference", i, systime_task_scheduled(&tasks[i]), ref[i].scheduled);
+        ref[i].added_in_run = 0;
+    }
+}
+
+
+
+int main(int argc, char **argv)
+{
+    unsigned long long steps = 2000000;
+    unsigned id;
+
+    if(argc > 1) steps = strtoull(argv[1], 0, 0);
+    if(argc > 2) rng_state = strtoull(argv[2], 0, 0) | 1;
+
+    systime_sched_init(&sched, now_fcn, heap, TASKS);
+    for(id = 0; id < TASKS; id++) systime_task_init(&tasks[id], task_fcn, 0);
+
+    for(step = 1; step <= steps; step++)
+    {
+        unsigned ops = (unsigned)(rng() % 4);
+
+        while(ops--)
+        {
+            id = (unsigned)(rng() % TASKS);
+            if(rng() % 8 == 0) task_cancel(id);
+            else task_add(id);
+        }
+
+        sim_now += random_gap(20);
+        run_check();
+    }
+
+    printf("sched soak: %llu steps, %llu failures\n", steps, failures);
+
+    return failures != 0;
+}
@@ -0,0 +1,255 @@
+// systime_soak.c
+
+/*
+    Host soak test of systime counters against exact reference.
+
+    Runs systime on simulated timer (systime_sim.h) with given hw_bits, tick_multiplier
+    and ticks_for_1ms, moves simulated time by random gaps up to full timer period and
+    after every gap checks systime_tick(), systime_ms(), systime_sec(), systime_sec_mono()
+    and 64-bit versions against exact values computed from total simulated time, so any drift,
+    lost ms or mishandled wrap is reported at the step it happens.
+
+    Before random gaps three regression phases run:
+    - boundary: gaps that end exactly at ms boundary, ms must advance at the boundary
+      (conversion loops used > and lagged 1 ms there)
+    - long gap: gaps between half and full timer period, which are allowed with one
+      context (stale sample check used to refuse them)
+    - sleep: sleeps of 1 to 2^8 timer periods folded in by systime_sleep_resync() with
+      elapsed wrong by up to almost half of timer period, which it must tolerate
+
+    After random gaps wall clock is changed, so systime_sec() is not checked there:
+    - slew: systime_adjust() with random delta_ms and period_sec, systime_sec_mono() must
+      stay exact, systime_sec() never goes backward, applied part is exactly delta_ms
+      minus systime_adjust_remaining() and wall clock ends exactly delta_ms from mono
+      after period_sec
+    - set: systime_sec_set() to random values and over msb, systime_sec() and low half of
+      systime_sec64() are set value, high half is not moved by step and wraps after it
+
+    Usage: systime_soak hw_bits tick_multiplier ticks_for_1ms [steps [seed]]
+    Returns 0 if all checks passed.
+*/
+
+#include "systime_sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static unsigned long long rng_state = 88172645463325252ULL;
+static unsigned long long failures;
+// whole 2^32 tick epochs that systime_tick64() missed in long gaps, see main()
+static unsigned long long tick64_missed;
+// timer ticks of up to 5 ms, gap between reads of slew phase
+static unsigned long long slew_gap_max;
+
+
+
+// xorshift64, deterministic for given seed
+static unsigned long long rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+
+
+// compare all counters with reference, returns nonzero on mismatch
+static int check(const char *phase, unsigned long long step)
+{
+    unsigned tick = systime_tick();
+    unsigned ms = systime_ms();
+    unsigned sec = systime_sec();
+    unsigned mono = systime_sec_mono();
+    unsigned long long tick64 = systime_tick64() + tick64_missed;
+    unsigned long long ms64 = systime_ms64();
+    unsigned long long sec64 = systime_sec64();
+    unsigned long long ref_ticks = systime_sim_ref_ticks();
+    unsigned long long ref_ms = systime_sim_ref_ms();
+    unsigned long long ref_sec = systime_sim_ref_sec();
+
+    if(tick == (unsigned)ref_ticks && ms == (unsigned)ref_ms && sec == (unsigned)ref_sec &&
+        mono == (unsigned)ref_sec && tick64 == ref_ticks && ms64 == ref_ms && sec64 == ref_sec) return 0;
+
+    if(failures++ < 10)
+    {
+        printf("  %s step %llu: tick %u/%u ms %u/%u sec %u/%u mono %u tick64 %llu/%llu ms64 %llu/%llu sec64 %llu/%llu\n",
+            phase, step, tick, (unsigned)ref_ticks, ms, (unsigned)ref_ms, sec, (unsigned)ref_sec, mono,
+            tick64, ref_ticks, ms64, ref_ms, sec64, ref_sec);
+    }
+    return 1;
+}
+
+
+
+// fail with message, returns 1 like check()
+static int fail(const char *phase, unsigned long long step, const char *what, long long a, long long b)
+{
+    if(failures++ < 10) printf("  %s step %llu: %s %lld/%lld\n", phase, step, what, a, b);
+    return 1;
+}
+
+
+
+// returns wall clock minus monotonic clock in ms, and checks monotonic seconds
+static long long wall_offset(const char *phase, unsigned long long step)
+{
+    unsigned sec = systime_sec();
+    unsigned mono = systime_sec_mono();
+    unsigned ms = systime_ms();
+    long long wall_ms = (long long)sec * 1000 + (unsigned)(ms - systime_ctx_default.last_ms);
+    long long mono_ms = (long long)mono * 1000 + (unsigned)(ms - systime_ctx_default.mono_last_ms);
+
+    if(mono != (unsigned)systime_sim_ref_sec()) fail(phase, step, "mono", mono, (unsigned)systime_sim_ref_sec());
+    return wall_ms - mono_ms;
+}
+
+
+
+// slew wall clock by delta_ms over period_sec, reading it every few ms
+static void slew_check(unsigned long long step, int delta_ms, unsigned period_sec)
+{
+    unsigned long long start = systime_sim_ref_ms();
+    unsigned long long stop = start + period_sec * 1000ULL;
+    long long offset = wall_offset("slew", step);
+    unsigned sec = systime_sec();
+
+    systime_adjust(delta_ms, period_sec);
+
+    while(systime_sim_ref_ms() < stop)
+    {
+        long long applied;
+
+        systime_sim_advance(rng() % slew_gap_max + 1);
+        applied = wall_offset("slew", step) - offset;
+
+        if((int)(systime_sec() - sec) < 0) fail("slew", step, "sec backward", systime_sec(), sec);
+        sec = systime_sec();
+        if(applied != delta_ms - systime_adjust_remaining())
+            fail("slew", step, "applied", applied, delta_ms - systime_adjust_remaining());
+    }
+
+    if(wall_offset("slew", step) - offset != delta_ms)
+        fail("slew", step, "end", wall_offset("slew", step) - offset, delta_ms);
+    if(systime_adjust_remaining() != 0) fail("slew", step, "remaining", systime_adjust_remaining(), 0);
+}
+
+
+
+// step wall clock to value and check it is read back without moving high half of sec64
+static void set_check(unsigned long long step, unsigned value, unsigned long long hi)
+{
+    systime_sec_set(value);
+    if(systime_sec() != value) fail("set", step, "sec", systime_sec(), value);
+    if(systime_sec64() != (hi << 32 | value)) fail("set", step, "sec64", (long long)systime_sec64(), (long long)(hi << 32 | value));
+}
+
+
+
+int main(int argc, char **argv)
+{
+    unsigned hw_bits, mult, ticks1ms;
+    unsigned long long steps = 2000000, period, random_max, i;
+    int wide;
+
+    if(argc < 4)
+    {
+        printf("usage: %s hw_bits tick_multiplier ticks_for_1ms [steps [seed]]\n", argv[0]);
+        return 2;
+    }
+
+    hw_bits = (unsigned)strtoul(argv[1], 0, 0);
+    mult = (unsigned)strtoul(argv[2], 0, 0);
+    ticks1ms = (unsigned)strtoul(argv[3], 0, 0);
+    if(argc > 4) steps = strtoull(argv[4], 0, 0);
+    if(argc > 5) rng_state = strtoull(argv[5], 0, 0) | 1;
+
+    // timer ticks of full timer period
+    period = 1ULL << hw_bits;
+
+    /*
+        systime_tick64() needs some read before ticks advance by half of unsigned period,
+        timer period times tick_multiplier is then longer than that. Random gaps stay
+        below it, long gaps check ms and seconds, and epochs missed by systime_tick64()
+        there must be whole.
+    */
+    wide = period * mult > (1ULL << 31);
+    random_max = wide ? (1ULL << 31) / mult - 1 : period - 1;
+
+    systime_sim_init(hw_bits, mult, ticks1ms);
+    check("start", 0);
+
+    // gaps ending exactly at ms boundary, only if whole ms is whole number of timer ticks
+    if(ticks1ms % mult == 0)
+    {
+        unsigned long long ms_ticks = ticks1ms / mult, k;
+
+        for(k = 1; k <= 1000 && k * ms_ticks < period; k++)
+        {
+            systime_sim_advance(k * ms_ticks);
+            check("boundary", k);
+        }
+    }
+
+    // gaps over half of timer period
+    for(i = 0; i < 1000; i++)
+    {
+        systime_sim_advance(period / 2 + rng() % (period / 2));
+        if(wide)
+        {
+            tick64_missed = systime_sim_ref_ticks() - systime_tick64();
+            if((unsigned)tick64_missed != 0) tick64_missed = 0;
+        }
+        check("long gap", i);
+    }
+
+    // sleeps of many timer periods, elapsed measured by other clock with error below half period
+    for(i = 0; i < 1000; i++)
+    {
+        unsigned long long gap = period + rng() % (period << 8);
+        long long err = (long long)(rng() % (period - 1)) - (long long)(period / 2 - 1);
+
+        systime_sim_advance(gap);
+        systime_sleep_resync(gap + err);
+        check("sleep", i);
+    }
+
+    // log-uniform random gaps, so short and long gaps are both frequent
+    for(i = 0; i < steps; i++)
+    {
+        unsigned bits = (unsigned)(rng() % hw_bits) + 1;
+        unsigned long long gap = rng() & ((1ULL << bits) - 1);
+
+        systime_sim_advance(gap > random_max ? random_max : gap);
+        check("random", i);
+    }
+
+    // slews over 1 to 10 s by up to half of period, both ways
+    slew_gap_max = 5ULL * ticks1ms / mult;
+    if(slew_gap_max > random_max) slew_gap_max = random_max;
+    if(slew_gap_max == 0) slew_gap_max = 1;
+    for(i = 0; i < 20; i++)
+    {
+        unsigned period_sec = (unsigned)(rng() % 10) + 1;
+        int delta_ms = (int)(rng() % (period_sec * 500U)) + 1;
+
+        slew_check(i, i & 1 ? -delta_ms : delta_ms, period_sec);
+    }
+
+    // steps to random values and around msb, then wrap from step near full period
+    {
+        unsigned long long hi = systime_sec64() >> 32;
+
+        for(i = 0; i < 1000; i++) set_check(i, (unsigned)rng(), hi);
+        set_check(i++, 0x7FFFFFFFU, hi);
+        set_check(i++, 0x80000000U, hi);
+        set_check(i++, 0x7FFFFFFFU, hi);
+        set_check(i++, 0xFFFFFFFEU, hi);
+        while((int)(systime_sec() - 0xFFFFFFFEU) < 3) systime_sim_advance(slew_gap_max);
+        if(systime_sec64() >> 32 != hi + 1) fail("set", i, "sec64 wrap", (long long)(systime_sec64() >> 32), (long long)hi + 1);
+    }
+
+    printf("soak hw_bits %u tick_multiplier %u ticks_for_1ms %u: %llu steps, %llu failures\n",
+        hw_bits, mult, ticks1ms, steps, failures);
+
+    return failures != 0;
+}
@@ -0,0 +1,192 @@
+// systime_timer_soak.c
+
+/*
+    Host soak test of timer wheel against reference list of deadlines.
+
+    Wheel runs on simulated time function. Random timers are added, restarted and
+    canceled, time jumps by random gaps from 0 to 2^28 units and poll is called. After
+    every poll no pending timer is expired, every timer function ran at first poll at
+    or after its deadline and never before it, and systime_timer_next() before poll is
+    exact distance to earliest reference deadline.
+
+    Before random steps timers are added with deadline now and in the past right after
+    poll at the same now, systime_timer_next() must return 0 and next poll at the same
+    now must run them.
+
+    Usage: systime_timer_soak [steps [seed]]
+    Returns 0 if all checks passed.
+*/
+
+#include "systime_timer.h"
+#include "systime_serial.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TIMERS 64
+
+static unsigned long long rng_state = 88172645463325252ULL;
+static unsigned long long failures;
+static unsigned sim_now = 0xFFFF0000U;
+
+static struct systime_timer_wheel wheel;
+static struct systime_timer timers[TIMERS];
+
+// reference state of every timer
+static struct
+{
+    int pending;
+    // added by timer function of current poll, it can still be expired after poll
+    int added_in_poll;
+    unsigned expires;
+    unsigned long long runs;
+} ref[TIMERS];
+
+static int in_poll;
+
+
+
+// xorshift64, deterministic for given seed
+static unsigned long long rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+
+
+static unsigned now_fcn(void)
+{
+    return sim_now;
+}
+
+
+
+static void fail(const char *what, unsigned long long step, unsigned id)
+{
+    if(failures++ < 10) printf("  step %llu timer %u now %u: %s\n", step, id, sim_now, what);
+}
+
+
+
+// log-uniform random number up to 2^bits - 1
+static unsigned random_gap(unsigned bits)
+{
+    unsigned b = (unsigned)(rng() % (bits + 1));
+    return (unsigned)(rng() & ((1ULL << b) - 1));
+}
+
+
+
+static void timer_add(unsigned id, unsigned expires)
+{
+    systime_timer_add(&wheel, &timers[id], expires);
+    ref[id].pending = 1;
+    ref[id].added_in_poll = in_poll;
+    ref[id].expires = expires;
+}
+
+
+
+static void timer_fcn(struct systime_timer *timer, void *arg)
+{
+    unsigned id = (unsigned)(timer - timers);
+
+    (void)arg;
+
+    if(!ref[id].pending) fail("run but not pending", 0, id);
+    else if(systime_before(sim_now, ref[id].expires)) fail("run before deadline", 0, id);
+    ref[id].pending = 0;
+    ref[id].runs++;
+
+    // sometimes restart from timer function, also already expired
+    if(rng() % 4 == 0) timer_add(id, sim_now - 2 + random_gap(12));
+}
+
+
+
+// returns reference distance to earliest deadline like systime_timer_next()
+static unsigned ref_next(void)
+{
+    unsigned min = SYSTIME_TIMER_NONE, i;
+
+    for(i = 0; i < TIMERS; i++)
+    {
+        if(!ref[i].pending) continue;
+        if(systime_before(ref[i].expires, sim_now)) return 0;
+        if(ref[i].expires - sim_now < min) min = ref[i].expires - sim_now;
+    }
+
+    return min;
+}
+
+
+
+static void poll_check(unsigned long long step)
+{
+    unsigned i;
+
+    if(systime_timer_next(&wheel) != ref_next()) fail("next differs from reference", step, 0);
+
+    in_poll = 1;
+    systime_timer_poll(&wheel);
+    in_poll = 0;
+
+    for(i = 0; i < TIMERS; i++)
+    {
+        if(ref[i].pending && !ref[i].added_in_poll && !systime_before(sim_now, ref[i].expires))
+        {
+            fail("expired but not run", step, i);
+            ref[i].pending = 0;
+            systime_timer_cancel(&wheel, &timers[i]);
+        }
+        if(ref[i].pending != systime_timer_pending(&timers[i])) fail("pending differs from reference", step, i);
+        ref[i].added_in_poll = 0;
+    }
+}
+
+
+
+int main(int argc, char **argv)
+{
+    unsigned long long steps = 2000000, i;
+    unsigned id;
+
+    if(argc > 1) steps = strtoull(argv[1], 0, 0);
+    if(argc > 2) rng_state = strtoull(argv[2], 0, 0) | 1;
+
+    systime_timer_wheel_init(&wheel, now_fcn);
+    for(id = 0; id < TIMERS; id++) systime_timer_init(&timers[id], timer_fcn, 0);
+
+    // timers due now and in the past added after poll at the same now
+    systime_timer_poll(&wheel);
+    timer_add(0, sim_now);
+    timer_add(1, sim_now - 5);
+    if(systime_timer_next(&wheel) != 0) fail("due timer but next is not 0", 0, 0);
+    poll_check(0);
+    if(ref[0].runs != 1 || ref[1].runs != 1) fail("due timer not run by poll at the same now", 0, 0);
+
+    for(i = 1; i <= steps; i++)
+    {
+        unsigned ops = (unsigned)(rng() % 4);
+
+        while(ops--)
+        {
+            id = (unsigned)(rng() % TIMERS);
+            if(rng() % 8 == 0)
+            {
+                systime_timer_cancel(&wheel, &timers[id]);
+                ref[id].pending = 0;
+            }
+            else timer_add(id, sim_now + random_gap(29));
+        }
+
+        sim_now += random_gap(28);
+        poll_check(i);
+    }
+
+    printf("timer soak: %llu steps, %llu failures\n", steps, failures);
+
+    return failures != 0;
+}
@@ -0,0 +1,73 @@
+// systime_batch.c
+
+#include "systime_batch.h"
+
+
+#define FRAC_ONE (1U << SYSTIME_BATCH_FRAC_BITS)
+
+
+
+// returns interval between samples when there are samples samples in ticks units, frac is set to fraction
+unsigned systime_batch_interval(unsigned ticks, unsigned samples, unsigned *frac)
+{
+    unsigned interval = ticks / samples;
+    unsigned rem = ticks - interval * samples;
+
+    *frac = (unsigned)(((unsigned long long)rem << SYSTIME_BATCH_FRAC_BITS) / samples);
+    return interval;
+}
+
+
+
+// returns time of first sample of count samples when last sample was at time last
+unsigned systime_batch_first(unsigned last, unsigned count, unsigned interval, unsigned frac)
+{
+    unsigned long long span;
+
+    if(count == 0) return last;
+
+    // the same rounding as systime_batch_fill(), so filled last timestamp is exactly last
+    span = (unsigned long long)(count - 1) * ((((unsigned long long)interval) << SYSTIME_BATCH_FRAC_BITS) + frac);
+    return last - (unsigned)(span >> SYSTIME_BATCH_FRAC_BITS);
+}
+
+
+
+// fills ts with count timestamps starting with first, interval and frac apart
+void systime_batch_fill(unsigned *ts, unsigned count, unsigned first, unsigned interval, unsigned frac)
+{
+    unsigned i = 0;
+
+    if(frac == 0)
+    {
+        unsigned step = 4 * interval;
+
+        // independent stores, the compiler can unroll or vectorize them
+        for(; i + 4 <= count; i += 4)
+        {
+            ts[i] = first;
+            ts[i + 1] = first + interval;
+            ts[i + 2] = first + 2 * interval;
+            ts[i + 3] = first + 3 * interval;
+            first += step;
+        }
+        for(; i < count; i++)
+        {
+            ts[i] = first;
+            first += interval;
+        }
+    }
+    else
+    {
+        unsigned acc = 0;
+
+        // carry of fraction is added without branch
+        for(; i < count; i++)
+        {
+            ts[i] = first;
+            acc += frac;
+            first += interval + (acc >> SYSTIME_BATCH_FRAC_BITS);
+            acc &= FRAC_ONE - 1;
+        }
+    }
+}
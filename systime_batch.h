@@ -0,0 +1,50 @@
+// systime_batch.h
+
+/*
+    Timestamps for bursts of samples.
+
+    Samples of ADC or UART DMA burst come at known rate, so instead of reading timer for
+    every sample, interrupt reads systime_tick() (or systime_us()) once when burst is
+    complete and timestamps of all samples are filled from it later, outside of interrupt.
+
+    Interval between samples is given as whole units and fraction of unit in
+    1 / 2^SYSTIME_BATCH_FRAC_BITS, so rates that are not integer number of ticks don't
+    accumulate error over burst. Timestamps are in the same units as reading, they wrap
+    with unsigned period like systime counters and are compared with serial number
+    arithmetic (systime_ms_elapsed() and similar macros).
+
+    Example: 44.1kHz samples, 10MHz ticks, DMA complete interrupt stores last = systime_tick()
+    unsigned frac;
+    unsigned interval = systime_batch_interval(10000000, 44100, &frac);
+    unsigned first = systime_batch_first(last, 256, interval, frac);
+    systime_batch_fill(ts, 256, first, interval, frac);
+*/
+
+
+#ifndef __SYSTIME_BATCH_H__
+#define __SYSTIME_BATCH_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif // _cplusplus
+
+// fraction bits of sample interval
+#define SYSTIME_BATCH_FRAC_BITS 16
+
+
+// returns interval between samples when there are samples samples in ticks units, frac is set to fraction
+unsigned systime_batch_interval(unsigned ticks, unsigned samples, unsigned *frac);
+
+// returns time of first sample of count samples when last sample was at time last
+unsigned systime_batch_first(unsigned last, unsigned count, unsigned interval, unsigned frac);
+
+// fills ts with count timestamps starting with first, interval and frac apart
+void systime_batch_fill(unsigned *ts, unsigned count, unsigned first, unsigned interval, unsigned frac);
+
+
+
+#ifdef __cplusplus
+}
+#endif // _cplusplus
+
+#endif // __SYSTIME_BATCH_H__
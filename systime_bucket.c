@@ -0,0 +1,160 @@
+// systime_bucket.c
+
+#include "systime_bucket.h"
+#include "systime_tick.h"
+
+
+
+// greatest common divisor, init only
+static unsigned long long gcd(unsigned long long a, unsigned long long b)
+{
+    while(b)
+    {
+        unsigned long long t = a % b;
+        a = b;
+        b = t;
+    }
+
+    return a;
+}
+
+
+
+// add tokens for ticks since last refill
+static void refill(struct systime_bucket *bucket)
+{
+    unsigned now = systime_tick();
+    unsigned elapsed = now - bucket->last;
+
+    // full bucket doesn't collect time, rate 0 never refills
+    if(bucket->tokens >= bucket->burst || bucket->den == 0)
+    {
+        bucket->last = now;
+        return;
+    }
+
+    if(elapsed >= bucket->fill)
+    {
+        bucket->tokens = bucket->burst;
+        bucket->last = now;
+        return;
+    }
+
+    // one token every iteration, iterations are paid by tokens taken after them
+    for(;;)
+    {
+        unsigned acc = bucket->acc + bucket->frac;
+        unsigned step = bucket->period;
+
+        if(acc >= bucket->den)
+        {
+            acc -= bucket->den;
+            step++;
+        }
+
+        if(elapsed < step) break;
+
+        elapsed -= step;
+        bucket->last += step;
+        bucket->acc = acc;
+
+        if(++bucket->tokens >= bucket->burst)
+        {
+            bucket->last = now;
+            break;
+        }
+    }
+}
+
+
+
+//##############################################################################################
+
+
+// set bucket of burst tokens that gets rate tokens per second, bucket starts full
+void systime_bucket_init(struct systime_bucket *bucket, unsigned burst, unsigned rate)
+{
+    // ticks for one token are num / den
+    unsigned long long num = (unsigned long long)systime_ticks_1ms_num() * 1000U;
+    unsigned long long den = (unsigned long long)systime_ticks_1ms_den() * rate;
+    unsigned long long g;
+
+    bucket->tokens = burst;
+    bucket->burst = burst;
+    bucket->last = systime_tick();
+    bucket->acc = 0;
+
+    if(rate == 0)
+    {
+        bucket->period = ~0U;
+        bucket->frac = 0;
+        bucket->den = 0;
+        bucket->fill = ~0U;
+        return;
+    }
+
+    g = gcd(num, den);
+    num /= g;
+    den /= g;
+
+    // keep fraction in unsigned, rounding of very large den is far below tick
+    while(den > ~0U)
+    {
+        num >>= 1;
+        den >>= 1;
+    }
+
+    if(num / den > ~0U)
+    {
+        bucket->period = ~0U;
+        bucket->frac = 0;
+    }
+    else
+    {
+        bucket->period = (unsigned)(num / den);
+        bucket->frac = (unsigned)(num % den);
+    }
+    bucket->den = (unsigned)den;
+
+    // ticks to fill empty bucket, rounded up
+    if(bucket->period && burst > ~0U / bucket->period)
+    {
+        bucket->fill = ~0U;
+    }
+    else
+    {
+        unsigned long long fill = (unsigned long long)burst * bucket->period +
+            ((unsigned long long)burst * bucket->frac + den - 1) / den;
+        bucket->fill = fill > ~0U ? ~0U : (unsigned)fill;
+    }
+}
+
+
+
+// takes one token, returns nonzero if it was available
+int systime_bucket_take(struct systime_bucket *bucket)
+{
+    return systime_bucket_take_n(bucket, 1);
+}
+
+
+
+// takes n tokens, returns nonzero if all were available, else takes none
+int systime_bucket_take_n(struct systime_bucket *bucket, unsigned n)
+{
+    refill(bucket);
+
+    if(bucket->tokens < n) return 0;
+
+    bucket->tokens -= n;
+    return 1;
+}
+
+
+
+// returns number of tokens available now
+unsigned systime_bucket_tokens(struct systime_bucket *bucket)
+{
+    refill(bucket);
+    return bucket->tokens;
+}
@@ -0,0 +1,73 @@
+// systime_bucket.h
+
+/*
+    Token bucket rate limiter on systime_tick().
+
+    Bucket holds at most burst tokens and gets rate tokens per second. Every allowed event
+    takes one token (or n of them), when bucket is empty events are refused. Bucket
+    starts full.
+
+    Refill is lazy, done by the call that takes token, and there is no divide per call:
+    ticks for one token are kept as whole ticks and Bresenham fraction like in
+    systime_ms(), so average rate is exact, and every refill loop iteration adds one token.
+    Iterations are amortized to one per taken token, and idle bucket longer than time
+    to fill it is set full at once. Only systime_bucket_init() divides, it reads ticks for
+    1 ms of time base there, so after rate of time base changes (systime_calib_ref())
+    initialize bucket again.
+
+    Time is compared as difference of systime_tick() values, so counter wrap doesn't
+    matter. Bucket that is full stays full however long it is not used. Bucket that is not
+    full and is not used longer than full period of systime_tick() sees only remainder of
+    idle time, so it may refill later than it could, it never allows more than rate.
+
+    Bucket is not locked, use it from one context or under lock.
+
+    Example: at most 10 log lines per second, bursts of 20
+    struct systime_bucket log_bucket;
+    systime_bucket_init(&log_bucket, 20, 10);
+    if(systime_bucket_take(&log_bucket)) printf(...);
+*/
+
+
+#ifndef __SYSTIME_BUCKET_H__
+#define __SYSTIME_BUCKET_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif // _cplusplus
+
+struct systime_bucket
+{
+    unsigned tokens;
+    unsigned burst;
+    // systime_tick() up to which tokens were added
+    unsigned last;
+    // ticks for one token are period + frac / den, acc is Bresenham accumulator of frac
+    unsigned period;
+    unsigned frac;
+    unsigned den;
+    unsigned acc;
+    // ticks to fill empty bucket, ~0 if longer
+    unsigned fill;
+};
+
+
+// set bucket of burst tokens that gets rate tokens per second, bucket starts full
+void systime_bucket_init(struct systime_bucket *bucket, unsigned burst, unsigned rate);
+
+// takes one token, returns nonzero if it was available
+int systime_bucket_take(struct systime_bucket *bucket);
+
+// takes n tokens, returns nonzero if all were available, else takes none
+int systime_bucket_take_n(struct systime_bucket *bucket, unsigned n);
+
+// returns number of tokens available now
+unsigned systime_bucket_tokens(struct systime_bucket *bucket);
+
+
+
+#ifdef __cplusplus
+}
+#endif // _cplusplus
+
+#endif // __SYSTIME_BUCKET_H__
@@ -0,0 +1,92 @@
+// systime_calib.c
+
+#include "systime_calib.h"
+
+#if defined(SYSTIME_HAVE_CTX)
+
+
+// set ms rate of context to estimate, rounded to nearest
+static void calib_apply(struct systime_calib *calib)
+{
+    unsigned long long per = (unsigned long long)calib->interval_ms << SYSTIME_CALIB_FRAC_BITS;
+    unsigned num = (unsigned)((calib->estimate * SYSTIME_CALIB_DEN + (per >> 1)) / per);
+
+    systime_time_ms_rate_ctx(calib->ctx, num, SYSTIME_CALIB_DEN);
+}
+
+
+
+//##############################################################################################
+
+
+void systime_calib_init(struct systime_calib *calib, struct systime_ctx *ctx, unsigned interval_ms, unsigned shift)
+{
+    calib->ctx = ctx;
+    calib->interval_ms = interval_ms;
+    calib->shift = shift;
+    calib->last_ref = 0;
+    calib->count = 0;
+    calib->rejects = 0;
+
+    // nominal ticks for interval from current rate of context, div / den ticks for 1 ms
+    calib->nominal = ((((unsigned long long)ctx->ms.div * interval_ms) << SYSTIME_CALIB_FRAC_BITS)
+        + (ctx->ms.den >> 1)) / ctx->ms.den;
+    calib->estimate = calib->nominal;
+
+    calib_apply(calib);
+}
+
+
+
+void systime_calib_ref(struct systime_calib *calib, unsigned ticks)
+{
+    unsigned long long meas;
+    long long err;
+
+    // first reference only gives start of interval
+    if(calib->count == 0)
+    {
+        calib->count = 1;
+        calib->last_ref = ticks;
+        return;
+    }
+
+    meas = (unsigned long long)(ticks - calib->last_ref) << SYSTIME_CALIB_FRAC_BITS;
+    calib->last_ref = ticks;
+    err = (long long)(meas - calib->estimate);
+
+    // missed or false edge, or clock changed so much that estimate is restarted
+    if((unsigned long long)(err < 0 ? -err : err) > (calib->estimate >> SYSTIME_CALIB_REJECT_SHIFT))
+    {
+        if(++calib->rejects < SYSTIME_CALIB_REJECT_MAX) return;
+        calib->estimate = meas;
+    }
+    else
+    {
+        // arithmetic shift of signed error, estimate moves 1 / 2^shift of the way
+        calib->estimate += err >> calib->shift;
+    }
+
+    calib->rejects = 0;
+    calib->count++;
+    calib_apply(calib);
+}
+
+
+
+void systime_calib_restart(struct systime_calib *calib)
+{
+    calib->count = 0;
+    calib->rejects = 0;
+}
+
+
+
+int systime_calib_ppm(struct systime_calib *calib)
+{
+    long long diff = (long long)(calib->estimate - calib->nominal);
+
+    return (int)(diff * 1000000 / (long long)calib->nominal);
+}
+
+#endif // SYSTIME_HAVE_CTX
@@ -0,0 +1,121 @@
+// systime_calib.h
+
+/*
+    Oscillator drift calibration.
+
+    Timer clock (RC oscillator, cheap crystal) can drift hundreds of ppm with temperature,
+    so rate given to systime_time_init() is wrong in the field. Calibration takes tick
+    timestamps of periodic reference events (GPS PPS, RTC 1Hz edge, NTP time over serial),
+    estimates real number of ticks for reference interval with integer IIR filter and
+    changes ms rate to it. Rate is changed without losing phase of current ms, so time
+    is slewed smoothly and never jumps backward.
+
+    Rate is set as fraction num / SYSTIME_CALIB_DEN ticks for 1 ms, so its resolution is
+    1 / (ticks_for_1ms * SYSTIME_CALIB_DEN), for example 6 ppm with 10MHz timer. Interval
+    between two calls to systime_ms() must be less than full unsigned period of ticks
+    divided by SYSTIME_CALIB_DEN.
+
+    Only ms rate (and seconds, which count ms) is calibrated. systime_us() keeps nominal
+    rate set by systime_time_init_ctx(), so its call interval is not shortened by
+    SYSTIME_CALIB_DEN and recalibration never drops partial us.
+
+    systime_delay.h, systime_poll.h and systime_bucket.h read ms rate of default time base
+    (systime_ticks_1ms_num()) only when they are initialized and don't follow calibration,
+    call systime_delay_init() and systime_bucket_init() again and restart polls after
+    estimate settles, when their tick counts should follow it.
+
+    Reference timestamps which differ from estimate more than 1 / 2^SYSTIME_CALIB_REJECT_SHIFT
+    (missed or false edge) are rejected, after SYSTIME_CALIB_REJECT_MAX rejects in row
+    estimate is restarted from measured interval.
+
+    Example: 1Hz PPS captured by timer input capture
+    static struct systime_calib calib;
+
+    systime_calib_init(&calib, &systime_ctx_default, 1000, 4);
+
+    void pps_isr(void)
+    {
+        systime_calib_ref(&calib, capture_to_ticks());
+    }
+
+    Calibration works on rate of context given to systime_calib_init(), it must be used
+    from the same context as other systime calls of that time base or with interrupts
+    disabled. Not available with SYSTIME_STATIC_CONFIG or SYSTIME_POSIX.
+*/
+
+
+#ifndef __SYSTIME_CALIB_H__
+#define __SYSTIME_CALIB_H__
+
+#include "systime_tick.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif // _cplusplus
+
+#if defined(SYSTIME_HAVE_CTX)
+
+// denominator of calibrated ticks for 1 ms
+#if !defined(SYSTIME_CALIB_DEN)
+#define SYSTIME_CALIB_DEN 16
+#endif // SYSTIME_CALIB_DEN
+
+// fraction bits of filtered interval
+#if !defined(SYSTIME_CALIB_FRAC_BITS)
+#define SYSTIME_CALIB_FRAC_BITS 8
+#endif // SYSTIME_CALIB_FRAC_BITS
+
+// measured interval is rejected if it differs from estimate more than estimate >> shift
+#if !defined(SYSTIME_CALIB_REJECT_SHIFT)
+#define SYSTIME_CALIB_REJECT_SHIFT 8
+#endif // SYSTIME_CALIB_REJECT_SHIFT
+
+// number of rejects in row after which estimate is restarted
+#if !defined(SYSTIME_CALIB_REJECT_MAX)
+#define SYSTIME_CALIB_REJECT_MAX 4
+#endif // SYSTIME_CALIB_REJECT_MAX
+
+struct systime_calib
+{
+    struct systime_ctx *ctx;
+    // reference interval in ms
+    unsigned interval_ms;
+    // filter weight of new measurement is 1 / 2^shift
+    unsigned shift;
+    // ticks of last reference
+    unsigned last_ref;
+    // number of accepted references, 0 before first one
+    unsigned count;
+    unsigned rejects;
+    // ticks for reference interval, nominal and filtered, with SYSTIME_CALIB_FRAC_BITS fraction
+    unsigned long long nominal;
+    unsigned long long estimate;
+};
+
+
+/*
+    initialize calibration of time base ctx, its rate set by systime_time_init_ctx()
+    is nominal rate. interval_ms is period of reference events and shift is filter
+    strength, larger is smoother but slower, 0 applies every measurement directly.
+    Interval must be shorter than full unsigned period of ticks.
+*/
+void systime_calib_init(struct systime_calib *calib, struct systime_ctx *ctx, unsigned interval_ms, unsigned shift);
+
+// reference event happened at tick count ticks, it updates estimate and ms rate
+void systime_calib_ref(struct systime_calib *calib, unsigned ticks);
+
+// forget last reference, for example after reference signal was lost
+void systime_calib_restart(struct systime_calib *calib);
+
+// returns estimated oscillator error against nominal rate in ppm, positive if clock is fast
+int systime_calib_ppm(struct systime_calib *calib);
+
+#endif // SYSTIME_HAVE_CTX
+
+
+
+#ifdef __cplusplus
+}
+#endif // _cplusplus
+
+#endif // __SYSTIME_CALIB_H__
@@ -0,0 +1,72 @@
+// systime_coarse.c
+
+#include "systime_tick.h"
+#include "systime_sync.h"
+
+
+/*
+    Coarse time reads.
+
+    Code that only needs ms granularity often calls systime_ms() many times in the same
+    milisecond, and every call reads timer peripheral. Coarse reads return counters
+    published by last update and never touch timer, like Linux CLOCK_MONOTONIC_COARSE.
+
+    systime_coarse_update() is the single update point, call it from periodic interrupt
+    or scheduler tick. Coarse value lags real time by at most one update interval.
+*/
+
+
+
+#if !defined(SYSTIME_POSIX)
+
+// returns miliseconds counter published by last update without reading timer
+unsigned systime_ms_coarse(void)
+{
+    return systime_sync_load(&systime_curr_ms);
+}
+
+
+
+// returns seconds counter published by last update without reading timer
+unsigned systime_sec_coarse(void)
+{
+    return systime_sync_load(&systime_curr_sec);
+}
+
+
+
+// reads timer once and publishes ticks, ms and seconds for coarse reads
+void systime_coarse_update(void)
+{
+    struct systime_snapshot now;
+    systime_now(&now);
+}
+
+#endif // SYSTIME_POSIX
+
+
+
+#if defined(SYSTIME_HAVE_CTX)
+
+// the same for time base ctx
+unsigned systime_ms_coarse_ctx(struct systime_ctx *ctx)
+{
+    return systime_sync_load(&ctx->ms.curr);
+}
+
+
+
+unsigned systime_sec_coarse_ctx(struct systime_ctx *ctx)
+{
+    return systime_sync_load(&ctx->curr_sec);
+}
+
+
+
+void systime_coarse_update_ctx(struct systime_ctx *ctx)
+{
+    struct systime_snapshot now;
+    systime_now_ctx(ctx, &now);
+}
+
+#endif // SYSTIME_HAVE_CTX
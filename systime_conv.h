@@ -0,0 +1,112 @@
+// systime_conv.h
+
+/*
+    Conversion of ticks to ms and us and of ms to seconds, shared by runtime configuration
+    (systime_ms.c, systime_sec.c) and static configuration (systime_static.h).
+
+    Conversion is selected at compile time, the same for all systime files:
+    SYSTEM_TIME_HAVE_DIV_INST   divide instruction
+    SYSTEM_TIME_USE_RECIPROCAL  constant time reciprocal multiplication without divide
+    otherwise                   while loops subtracting 50 units and then 1 unit
+
+    Static configuration passes compile time constants, so divisor, its reciprocal and
+    50 units are folded by the compiler, runtime configuration passes them from its
+    struct systime_rate.
+*/
+
+
+#ifndef __SYSTIME_CONV_H__
+#define __SYSTIME_CONV_H__
+
+#include "systime_sync.h"
+#include "systime_stats.h"
+
+
+// returns number of whole units in diff ticks, div ticks is one unit, div50 is 50 units, recip is ~0U / div
+static inline unsigned systime_conv_units(unsigned diff, unsigned div, unsigned div50, unsigned recip)
+{
+#if defined(SYSTEM_TIME_HAVE_DIV_INST)
+    (void)div50;
+    (void)recip;
+    return diff / div;
+#elif defined(SYSTEM_TIME_USE_RECIPROCAL)
+    unsigned q = (unsigned)(((unsigned long long)diff * recip) >> (8 * sizeof(unsigned)));
+    (void)div50;
+    // single correction step
+    if(diff - q * div >= div) q++;
+    return q;
+#else
+    unsigned q = 0;
+    (void)recip;
+    // we are using more while loops to have fewer iterations
+    while(diff >= div50)
+    {
+        diff -= div50;
+        q += 50;
+        systime_stat_inc(conv_loops);
+    }
+    while(diff >= div)
+    {
+        diff -= div;
+        q++;
+        systime_stat_inc(conv_loops);
+    }
+    return q;
+#endif  // SYSTEM_TIME_HAVE_DIV_INST
+}
+
+
+// returns number of whole seconds in ms
+static inline unsigned systime_conv_sec(unsigned ms)
+{
+#if defined(SYSTEM_TIME_HAVE_DIV_INST)
+    return ms / 1000U;
+#elif defined(SYSTEM_TIME_USE_RECIPROCAL)
+    // (n * 274877907) >> 38 is exactly n / 1000 for every 32-bit n
+    return (unsigned)(((unsigned long long)ms * 274877907ULL) >> 38);
+#else
+    unsigned q = 0;
+    // we are using more while loops to have fewer iterations
+    while(ms >= 50000U)
+    {
+        ms -= 50000U;
+        q += 50;
+        systime_stat_inc(sec_loops);
+    }
+    while(ms >= 1000U)
+    {
+        ms -= 1000U;
+        q++;
+        systime_stat_inc(sec_loops);
+    }
+    return q;
+#endif  // SYSTEM_TIME_HAVE_DIV_INST
+}
+
+
+/*
+    advances counter *curr_p with boundary of last whole unit *last_p to now and returns it.
+    sec is constant, 0 converts ticks with div, div50 and recip of systime_conv_units(),
+    1 converts ms to seconds with systime_conv_sec() and div must be 1000.
+*/
+static inline unsigned systime_conv_update(unsigned *last_p, unsigned *curr_p, unsigned now,
+    unsigned div, unsigned div50, unsigned recip, int sec)
+{
+    unsigned last = systime_sync_load(last_p);
+    unsigned q;
+
+    // every unit is counted only by caller that moved last over it
+    do
+    {
+        // other caller already converted past now
+        if(systime_sync_stale(now, last)) return systime_sync_load(curr_p);
+
+        q = sec ? systime_conv_sec(now - last) : systime_conv_units(now - last, div, div50, recip);
+        if(q == 0) return systime_sync_load(curr_p);
+    }
+    while(!systime_sync_cas(last_p, &last, last + q * div));
+
+    return systime_sync_add(curr_p, q) + q;
+}
+
+#endif // __SYSTIME_CONV_H__
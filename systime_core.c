@@ -0,0 +1,25 @@
+// systime_core.c
+
+#include "systime_core.h"
+
+#if defined(SYSTIME_HAVE_CTX)
+
+struct systime_core systime_cores[SYSTIME_CORES];
+
+
+
+/*
+    copy initialized context from to contexts of all cores.
+    Call it once before other cores and interrupts use per-core functions.
+*/
+void systime_core_init(struct systime_ctx *from)
+{
+    unsigned i;
+
+    // one snapshot for all cores, so they convert timer state to the same values
+    struct systime_ctx snap = *from;
+
+    for(i = 0; i < SYSTIME_CORES; i++) systime_cores[i].ctx = snap;
+}
+
+#endif // SYSTIME_HAVE_CTX
@@ -0,0 +1,93 @@
+// systime_core.h
+
+/*
+    Per-core systime for multicore MCUs.
+
+    When several cores call systime_ms() of one time base they all write its state, and
+    cache lines or bus locations bounce between cores. In per-core mode every core has
+    its own time base context in separate cache line, and only hardware timer is shared,
+    so systime calls of one core never write memory that other core reads.
+
+    Contexts of all cores are copies of one initialized context. Accumulated ticks, ms,
+    us and seconds of a context depend only on timer state and the state it started
+    from, so all cores convert every timer state to the same values: counters of two
+    cores read at the same timer state are equal, and if one core reads after other its
+    values are not smaller. Values of two cores differ only by ticks between their reads.
+
+    That holds as long as every core calls systime at least once in timer full period,
+    as every time base must. Timer must be shared by cores (not per-core cycle counter)
+    and overflow interrupt counting (systime_tick_overflow_init()) can't be used.
+    systime_sec_set() and systime_adjust() change one context only, so set wall clock
+    on source context before systime_core_init() and don't slew per-core contexts.
+
+    Define SYSTIME_CORE_ID() as expression that returns index of current core for files
+    that use per-core functions, for example
+    #define SYSTIME_CORE_ID() (*(volatile unsigned *)0xD0000000)   // RP2040 SIO CPUID
+
+    Example:
+    systime_tick_init(timer_read, 32, 1);
+    systime_time_init(1);
+    systime_core_init(&systime_ctx_default);
+    ... start other cores ...
+    unsigned ms = systime_core_ms();
+
+    Not available with SYSTIME_STATIC_CONFIG or SYSTIME_POSIX.
+*/
+
+
+#ifndef __SYSTIME_CORE_H__
+#define __SYSTIME_CORE_H__
+
+#include "systime_tick.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif // _cplusplus
+
+#if defined(SYSTIME_HAVE_CTX)
+
+// number of cores
+#if !defined(SYSTIME_CORES)
+#define SYSTIME_CORES 2
+#endif // SYSTIME_CORES
+
+// size of cache line or bus burst, context of every core starts at its own line
+#if !defined(SYSTIME_CORE_ALIGN)
+#define SYSTIME_CORE_ALIGN 32
+#endif // SYSTIME_CORE_ALIGN
+
+struct systime_core
+{
+    struct systime_ctx ctx;
+}
+#if defined(__GNUC__)
+__attribute__((aligned(SYSTIME_CORE_ALIGN)))
+#endif // __GNUC__
+;
+
+extern struct systime_core systime_cores[SYSTIME_CORES];
+
+
+/*
+    copy initialized context from to contexts of all cores.
+    Call it once before other cores and interrupts use per-core functions.
+*/
+void systime_core_init(struct systime_ctx *from);
+
+// context of current core
+#define systime_core_ctx() (&systime_cores[SYSTIME_CORE_ID()].ctx)
+
+#define systime_core_tick() systime_tick_ctx(systime_core_ctx())
+#define systime_core_ms() systime_ms_ctx(systime_core_ctx())
+#define systime_core_us() systime_us_ctx(systime_core_ctx())
+#define systime_core_sec() systime_sec_ctx(systime_core_ctx())
+
+#endif // SYSTIME_HAVE_CTX
+
+
+
+#ifdef __cplusplus
+}
+#endif // _cplusplus
+
+#endif // __SYSTIME_CORE_H__
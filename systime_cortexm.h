@@ -0,0 +1,129 @@
+// systime_cortexm.h
+
+/*
+    Ready made timers of Cortex-M core for systime.
+
+    DWT cycle counter (Cortex-M3 and up) is 32-bit up counter at core clock, so systime
+    reads it directly without accumulation (hw_bits 32, tick_multiplier 1).
+
+    SysTick (all Cortex-M) is 24-bit down counter. It is run with reload 0xFFFFFF so its
+    period is exactly 2^24, and read is inverted so systime sees up counter. SysTick can also
+    count periods in its interrupt with systime_tick_overflow_init(). COUNTFLAG is cleared by
+    every read of SYST_CSR, so it can't tell if wrap is not yet serviced, pending interrupt
+    flag PENDSTSET of ICSR is used for that instead.
+
+    Registers are accessed at their architectural addresses, there is no CMSIS dependency.
+    Reads are inline, in compile time configuration (systime_static.h) systime_tick()
+    is then one or two loads.
+
+    Example, runtime configuration, 72MHz core clock:
+    systime_dwt_init();
+    systime_tick_init(systime_dwt_read, 32, 1);
+    systime_time_init(72000);
+
+    Example, SysTick with overflow interrupt:
+    systime_systick_init(1);
+    systime_tick_init(systime_systick_read, 24, 1);
+    systime_tick_overflow_init(systime_systick_pending);
+    systime_time_init(72000);
+    void SysTick_Handler(void) { systime_tick_overflow_isr(); }
+
+    Example, compile time configuration header:
+    #include "systime_cortexm.h"
+    #define SYSTIME_STATIC_READ()       SYSTIME_DWT_CYCCNT
+    #define SYSTIME_STATIC_HW_BITS      32
+    #define SYSTIME_STATIC_TICKS_1MS    72000
+    and call systime_dwt_init() before systime_sec() at startup.
+*/
+
+
+#ifndef __SYSTIME_CORTEXM_H__
+#define __SYSTIME_CORTEXM_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif // _cplusplus
+
+#define SYSTIME_REG(addr) (*(volatile unsigned *)(addr))
+
+// debug exception and monitor control, TRCENA enables DWT
+#define SYSTIME_DEMCR               SYSTIME_REG(0xE000EDFC)
+#define SYSTIME_DEMCR_TRCENA        (1U << 24)
+
+#define SYSTIME_DWT_CTRL            SYSTIME_REG(0xE0001000)
+#define SYSTIME_DWT_CTRL_CYCCNTENA  (1U << 0)
+#define SYSTIME_DWT_CTRL_NOCYCCNT   (1U << 25)
+#define SYSTIME_DWT_CYCCNT          SYSTIME_REG(0xE0001004)
+// software lock of DWT on Cortex-M7
+#define SYSTIME_DWT_LAR             SYSTIME_REG(0xE0001FB0)
+#define SYSTIME_DWT_LAR_KEY         0xC5ACCE55U
+
+#define SYSTIME_SYST_CSR            SYSTIME_REG(0xE000E010)
+#define SYSTIME_SYST_RVR            SYSTIME_REG(0xE000E014)
+#define SYSTIME_SYST_CVR            SYSTIME_REG(0xE000E018)
+#define SYSTIME_SYST_CSR_ENABLE     (1U << 0)
+#define SYSTIME_SYST_CSR_TICKINT    (1U << 1)
+#define SYSTIME_SYST_CSR_CLKSOURCE  (1U << 2)
+#define SYSTIME_SYST_MAX            0xFFFFFFU
+
+// interrupt control and state, PENDSTSET is SysTick interrupt pending
+#define SYSTIME_ICSR                SYSTIME_REG(0xE000ED04)
+#define SYSTIME_ICSR_PENDSTSET      (1U << 26)
+
+// SysTick as up counter
+#define SYSTIME_SYSTICK_UP()        (SYSTIME_SYST_MAX - SYSTIME_SYST_CVR)
+
+
+// start DWT cycle counter, returns 0 if core doesn't have it (Cortex-M0/M0+/M23)
+static inline int systime_dwt_init(void)
+{
+    SYSTIME_DEMCR |= SYSTIME_DEMCR_TRCENA;
+    SYSTIME_DWT_LAR = SYSTIME_DWT_LAR_KEY;
+
+    if(SYSTIME_DWT_CTRL & SYSTIME_DWT_CTRL_NOCYCCNT) return 0;
+
+    SYSTIME_DWT_CYCCNT = 0;
+    SYSTIME_DWT_CTRL |= SYSTIME_DWT_CTRL_CYCCNTENA;
+    return 1;
+}
+
+// returns DWT cycle counter, timer function for systime_tick_init(fcn, 32, 1)
+static inline unsigned systime_dwt_read(void)
+{
+    return SYSTIME_DWT_CYCCNT;
+}
+
+
+/*
+    start SysTick with full 24-bit period at core clock.
+    interrupt nonzero enables SysTick interrupt for systime_tick_overflow_init(),
+    SysTick can then not be used as RTOS tick with other period.
+*/
+static inline void systime_systick_init(int interrupt)
+{
+    SYSTIME_SYST_CSR = 0;
+    SYSTIME_SYST_RVR = SYSTIME_SYST_MAX;
+    SYSTIME_SYST_CVR = 0;
+    SYSTIME_SYST_CSR = SYSTIME_SYST_CSR_CLKSOURCE | SYSTIME_SYST_CSR_ENABLE |
+        (interrupt ? SYSTIME_SYST_CSR_TICKINT : 0);
+}
+
+// returns SysTick counter counting up, timer function for systime_tick_init(fcn, 24, 1)
+static inline unsigned systime_systick_read(void)
+{
+    return SYSTIME_SYSTICK_UP();
+}
+
+// nonzero if SysTick wrapped and its interrupt is not yet serviced, for systime_tick_overflow_init()
+static inline unsigned systime_systick_pending(void)
+{
+    return SYSTIME_ICSR & SYSTIME_ICSR_PENDSTSET;
+}
+
+
+
+#ifdef __cplusplus
+}
+#endif // _cplusplus
+
+#endif // __SYSTIME_CORTEXM_H__
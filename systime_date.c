@@ -0,0 +1,229 @@
+// systime_date.c
+
+#include "systime_date.h"
+
+
+#define SEC_DAY 86400U
+
+// days from 0000-03-01 to 1970-01-01 in proleptic Gregorian calendar
+#define DAYS_TO_1970 719468U
+
+static const unsigned char month_days[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+
+
+// leap year in range 1970 to 2105 without division
+static unsigned is_leap(unsigned year)
+{
+    return (year & 3) == 0 && year != 2100;
+}
+
+
+
+// days of month of date, month must be 1 to 12
+static unsigned days_in_month(const struct systime_date *date)
+{
+    return month_days[date->month - 1] + (date->month == 2 && is_leap(date->year));
+}
+
+
+
+// true if fields are date from systime_date_from_sec(), zeroed or corrupted date is not
+static int date_valid(const struct systime_date *date)
+{
+    if(date->month < 1 || date->month > 12) return 0;
+    if(date->day < 1 || date->day > days_in_month(date)) return 0;
+    return date->hour < 24 && date->min < 60 && date->sec < 60 && date->wday < 7;
+}
+
+
+
+// date must be valid, see date_valid()
+static void next_day(struct systime_date *date)
+{
+    unsigned last = days_in_month(date);
+
+    date->wday = date->wday == 6 ? 0 : date->wday + 1;
+
+    if(date->day < last)
+    {
+        date->day++;
+        return;
+    }
+
+    date->day = 1;
+    if(date->month < 12) date->month++;
+    else
+    {
+        date->month = 1;
+        date->year++;
+    }
+}
+
+
+
+// writes value as count decimal digits with leading zeros, returns pointer after them
+static char *put_digits(char *p, unsigned value, unsigned count)
+{
+    char *end = p + count;
+
+    // every digit by repeated subtraction, there is no division
+    while(count > 0)
+    {
+        unsigned scale = 1, i, digit;
+
+        for(i = 1; i < count; i++) scale *= 10;
+
+        digit = 0;
+        while(value >= scale)
+        {
+            value -= scale;
+            digit++;
+        }
+        *p++ = (char)('0' + digit);
+        count--;
+    }
+
+    return end;
+}
+
+
+
+//##############################################################################################
+
+
+/*
+    Days are converted to civil date by algorithm of Howard Hinnant
+    (chrono-compatible low-level date algorithms), with years starting at March 1st
+    so leap day is the last day of year.
+*/
+void systime_date_from_sec(struct systime_date *date, unsigned time)
+{
+    unsigned days = time / SEC_DAY;
+    unsigned sod = time - days * SEC_DAY;
+    unsigned z = days + DAYS_TO_1970;
+    unsigned era = z / 146097U;
+    unsigned doe = z - era * 146097U;
+    unsigned yoe = (doe - doe / 1460U + doe / 36524U - doe / 146096U) / 365U;
+    unsigned doy = doe - (365U * yoe + yoe / 4U - yoe / 100U);
+    unsigned mp = (5U * doy + 2U) / 153U;
+    unsigned month = mp < 10 ? mp + 3 : mp - 9;
+
+    date->time = time;
+    date->year = (unsigned short)(yoe + era * 400U + (month <= 2));
+    date->month = (unsigned char)month;
+    date->day = (unsigned char)(doy - (153U * mp + 2U) / 5U + 1U);
+    date->hour = (unsigned char)(sod / 3600U);
+    sod -= date->hour * 3600U;
+    date->min = (unsigned char)(sod / 60U);
+    date->sec = (unsigned char)(sod - date->min * 60U);
+    // 1970-01-01 was Thursday
+    date->wday = (unsigned char)((days + 4U) % 7U);
+}
+
+
+
+unsigned systime_date_to_sec(const struct systime_date *date)
+{
+    unsigned year = date->year - (date->month <= 2);
+    unsigned era = year / 400U;
+    unsigned yoe = year - era * 400U;
+    unsigned mp = date->month > 2 ? date->month - 3U : date->month + 9U;
+    unsigned doy = (153U * mp + 2U) / 5U + date->day - 1U;
+    unsigned doe = yoe * 365U + yoe / 4U - yoe / 100U + doy;
+    unsigned days = era * 146097U + doe - DAYS_TO_1970;
+
+    return days * SEC_DAY + date->hour * 3600U + date->min * 60U + date->sec;
+}
+
+
+
+// advance date to seconds since 1970-01-01 time, incrementally if it is less than a day ahead
+void systime_date_update(struct systime_date *date, unsigned time)
+{
+    unsigned delta = time - date->time;
+
+    // backward or more than a day, unsigned delta covers both, time wrapped over full
+    // unsigned range back to 1970, or date was never converted
+    if(delta >= SEC_DAY || time < date->time || !date_valid(date))
+    {
+        systime_date_from_sec(date, time);
+        return;
+    }
+
+    date->time = time;
+
+    while(delta >= 3600U)
+    {
+        delta -= 3600U;
+        date->hour++;
+    }
+    while(delta >= 60U)
+    {
+        delta -= 60U;
+        date->min++;
+    }
+    delta += date->sec;
+    if(delta >= 60U)
+    {
+        delta -= 60U;
+        date->min++;
+    }
+    date->sec = (unsigned char)delta;
+
+    if(date->min >= 60)
+    {
+        date->min -= 60;
+        date->hour++;
+    }
+    if(date->hour >= 24)
+    {
+        date->hour -= 24;
+        next_day(date);
+    }
+}
+
+
+
+// advance date to systime_sec()
+void systime_date_now(struct systime_date *date)
+{
+    systime_date_update(date, systime_sec());
+}
+
+
+
+// writes "YYYY-MM-DD hh:mm:ss" and terminating 0 to buf, returns number of characters
+unsigned systime_date_format(char *buf, const struct systime_date *date)
+{
+    char *p = buf;
+
+    p = put_digits(p, date->year, 4);
+    *p++ = '-';
+    p = put_digits(p, date->month, 2);
+    *p++ = '-';
+    p = put_digits(p, date->day, 2);
+    *p++ = ' ';
+    p = put_digits(p, date->hour, 2);
+    *p++ = ':';
+    p = put_digits(p, date->min, 2);
+    *p++ = ':';
+    p = put_digits(p, date->sec, 2);
+    *p = 0;
+
+    return (unsigned)(p - buf);
+}
+
+
+
+// the same with ".mmm" appended, ms is fraction of second from 0 to 999
+unsigned systime_date_format_ms(char *buf, const struct systime_date *date, unsigned ms)
+{
+    char *p = buf + systime_date_format(buf, date);
+
+    *p++ = '.';
+    p = put_digits(p, ms, 3);
+    *p = 0;
+
+    return (unsigned)(p - buf);
+}
@@ -0,0 +1,91 @@
+// systime_date.h
+
+/*
+    Calendar date and time of day from systime_sec().
+
+    With systime_sec_set() given Unix time (seconds since 1970-01-01 00:00:00 UTC)
+    systime_sec() is wall clock. Full conversion to year, month, day and time of day
+    needs several divisions, which are library calls on cores without divide instruction.
+    systime_date keeps broken down time of last conversion and systime_date_update()
+    only adds elapsed seconds to it with carry to minutes, hours and days, so for log
+    timestamps there is no division at all. Full conversion is done only if time goes
+    backward or more than one day passed since last update.
+
+    systime_date_format() writes "YYYY-MM-DD hh:mm:ss" to caller buffer without printf.
+
+    Example:
+    static struct systime_date date;
+
+    systime_sec_set(1700000000);
+    systime_date_from_sec(&date, systime_sec());
+    ...
+    char buf[SYSTIME_DATE_LEN];
+    systime_date_now(&date);
+    systime_date_format(buf, &date);
+
+    Every systime_date is independent, use separate ones from different contexts.
+    Times are unsigned, so years 1970 to 2105 are covered.
+*/
+
+
+#ifndef __SYSTIME_DATE_H__
+#define __SYSTIME_DATE_H__
+
+#include "systime_tick.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif // _cplusplus
+
+// buffer size for systime_date_format(), including terminating 0
+#define SYSTIME_DATE_LEN 20
+
+// buffer size for systime_date_format_ms(), including terminating 0
+#define SYSTIME_DATE_MS_LEN 24
+
+struct systime_date
+{
+    // seconds since 1970-01-01 for which fields below are valid
+    unsigned time;
+    unsigned short year;
+    // 1 to 12
+    unsigned char month;
+    // 1 to 31
+    unsigned char day;
+    unsigned char hour;
+    unsigned char min;
+    unsigned char sec;
+    // day of week, 0 is Sunday
+    unsigned char wday;
+};
+
+
+// full conversion of seconds since 1970-01-01 to date
+void systime_date_from_sec(struct systime_date *date, unsigned time);
+
+// returns seconds since 1970-01-01 of date, time field is ignored, month must be 1 to 12 and day 1 to 31
+unsigned systime_date_to_sec(const struct systime_date *date);
+
+/*
+    advance date to seconds since 1970-01-01 time, incrementally if it is less than a day
+    ahead. Date that is not valid (zeroed struct, month not 1 to 12) or time that wrapped
+    over 2106-02-07 06:28:15 back to 1970 is fully converted.
+*/
+void systime_date_update(struct systime_date *date, unsigned time);
+
+// advance date to systime_sec()
+void systime_date_now(struct systime_date *date);
+
+// writes "YYYY-MM-DD hh:mm:ss" and terminating 0 to buf, returns number of characters
+unsigned systime_date_format(char *buf, const struct systime_date *date);
+
+// the same with ".mmm" appended, ms is fraction of second from 0 to 999
+unsigned systime_date_format_ms(char *buf, const struct systime_date *date, unsigned ms);
+
+
+
+#ifdef __cplusplus
+}
+#endif // _cplusplus
+
+#endif // __SYSTIME_DATE_H__
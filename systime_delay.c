@@ -0,0 +1,130 @@
+// systime_delay.c
+
+#include "systime_delay.h"
+#include "systime_tick.h"
+
+// longest wait on systime_tick() at once, less than half of unsigned period
+#define WAIT_MAX (1U << (8 * sizeof(unsigned) - 2))
+
+// fraction bits of loop and us rates
+#define FRAC_BITS 16
+
+// ticks of one systime_tick() call
+static unsigned overhead;
+// delays shorter than this use loop
+static unsigned short_ticks;
+// loop iterations for one tick, with FRAC_BITS fraction
+static unsigned long long loops_tick;
+// ticks for one us, with FRAC_BITS fraction
+static unsigned long long ticks_us;
+
+
+
+static void spin(unsigned n)
+{
+    volatile unsigned i = n;
+    while(i) i--;
+}
+
+
+
+// wait until ticks counter advanced more than ticks
+static void wait_ticks(unsigned long long ticks)
+{
+    while(ticks > 0)
+    {
+        unsigned t = ticks > WAIT_MAX ? WAIT_MAX : (unsigned)ticks;
+        unsigned start = systime_tick();
+
+        // one tick more, start can be read right before tick counter advances
+        while(systime_tick() - start <= t);
+        ticks -= t;
+    }
+}
+
+
+
+static void delay(unsigned long long ticks)
+{
+    if(ticks < short_ticks)
+    {
+        // round up, delay is never shorter than requested
+        spin((unsigned)((ticks * loops_tick + (1U << FRAC_BITS) - 1) >> FRAC_BITS));
+        return;
+    }
+
+    wait_ticks(ticks);
+}
+
+
+
+//##############################################################################################
+
+
+// measure loop speed and systime_tick() overhead
+void systime_delay_init(void)
+{
+    unsigned long long den;
+    unsigned i;
+
+    // minimum is cost when it is not disturbed by interrupts
+    overhead = ~0U;
+    for(i = 0; i < 16; i++)
+    {
+        unsigned start = systime_tick();
+        unsigned ticks = systime_tick() - start;
+        if(ticks < overhead) overhead = ticks;
+    }
+
+    short_ticks = SYSTIME_DELAY_SHORT_MULT * (overhead + 1);
+
+    // fastest run, so loop count is never too small
+    loops_tick = 0;
+    for(i = 0; i < SYSTIME_DELAY_CALIB_RUNS; i++)
+    {
+        unsigned n = 16, ticks;
+        unsigned long long rate;
+
+        // loop long enough for 1% resolution of ticks
+        for(;;)
+        {
+            unsigned start = systime_tick();
+            spin(n);
+            ticks = systime_tick() - start;
+            if(ticks >= 100 + overhead || n >= (1U << 24)) break;
+            n *= 2;
+        }
+
+        ticks = ticks > overhead ? ticks - overhead : 1;
+        rate = (((unsigned long long)n << FRAC_BITS) + ticks - 1) / ticks;
+        if(rate > loops_tick) loops_tick = rate;
+    }
+
+    // us rate is read only here, see systime_ticks_1ms_num()
+    den = systime_ticks_1ms_den() * 1000ULL;
+    ticks_us = (((unsigned long long)systime_ticks_1ms_num() << FRAC_BITS) + den - 1) / den;
+}
+
+
+
+// wait at least ticks internal ticks
+void systime_delay_ticks(unsigned ticks)
+{
+    delay(ticks);
+}
+
+
+
+// wait at least us microseconds
+void systime_delay_us(unsigned us)
+{
+    delay((us * ticks_us + (1U << FRAC_BITS) - 1) >> FRAC_BITS);
+}
+
+
+
+// wait at least ms miliseconds
+void systime_delay_ms(unsigned ms)
+{
+    delay(((unsigned long long)ms * systime_ticks_1ms_num() + systime_ticks_1ms_den() - 1) / systime_ticks_1ms_den());
+}
@@ -0,0 +1,64 @@
+// systime_delay.h
+
+/*
+    Busy-wait delays on top of systime_tick().
+
+    Long delays spin on systime_tick(). For delays of few ticks cost of systime_tick()
+    itself is larger than delay, so they run calibrated empty loop instead. Loop speed
+    and systime_tick() overhead are measured in systime_delay_init() against
+    systime_tick(), call it after systime_time_init() and again if core clock or rate of
+    time base changes, also by systime_calib_ref().
+
+    Delays are never shorter than requested. Worst-case overshoot without interrupts:
+    long delays (at least SYSTIME_DELAY_SHORT_MULT times systime_tick() overhead) wait
+    for counter to advance one tick more than requested, so up to 1 tick plus one
+    systime_tick() call. Short delays are rounded up to whole loop iterations, so up to
+    1 iteration plus call overhead, and loop count is rounded up from fastest of
+    SYSTIME_DELAY_CALIB_RUNS calibration runs. Interrupts during delay extend it by their
+    run time.
+
+    Example: bit-bang 2us pulse
+    systime_delay_init();
+    pin_set();
+    systime_delay_us(2);
+    pin_clear();
+*/
+
+
+#ifndef __SYSTIME_DELAY_H__
+#define __SYSTIME_DELAY_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif // _cplusplus
+
+// delays shorter than this many systime_tick() overheads use calibrated loop
+#if !defined(SYSTIME_DELAY_SHORT_MULT)
+#define SYSTIME_DELAY_SHORT_MULT 4
+#endif // SYSTIME_DELAY_SHORT_MULT
+
+// number of calibration runs, fastest is used
+#if !defined(SYSTIME_DELAY_CALIB_RUNS)
+#define SYSTIME_DELAY_CALIB_RUNS 4
+#endif // SYSTIME_DELAY_CALIB_RUNS
+
+
+// measure loop speed and systime_tick() overhead
+void systime_delay_init(void);
+
+// wait at least ticks internal ticks
+void systime_delay_ticks(unsigned ticks);
+
+// wait at least us microseconds
+void systime_delay_us(unsigned us);
+
+// wait at least ms miliseconds
+void systime_delay_ms(unsigned ms);
+
+
+
+#ifdef __cplusplus
+}
+#endif // _cplusplus
+
+#endif // __SYSTIME_DELAY_H__
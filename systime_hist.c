@@ -0,0 +1,97 @@
+// systime_hist.c
+
+#include "systime_hist.h"
+
+
+
+// clear all counters, call it from writer context or while writer is stopped
+void systime_hist_reset(struct systime_hist *hist)
+{
+    unsigned i;
+
+    for(i = 0; i < SYSTIME_HIST_BUCKETS; i++) hist->count[i] = 0;
+    hist->max = 0;
+}
+
+
+
+// copy hist to snap while writer of hist keeps running
+void systime_hist_snapshot(struct systime_hist *snap, const struct systime_hist *hist)
+{
+    const volatile unsigned *count = hist->count;
+    unsigned i;
+
+    // every counter is read once as whole word
+    for(i = 0; i < SYSTIME_HIST_BUCKETS; i++) snap->count[i] = count[i];
+
+    // writer stores max before count, so max read after counters covers all copied samples
+    systime_sync_acquire();
+    snap->max = *(const volatile unsigned *)&hist->max;
+}
+
+
+
+// add counters of src to dst
+void systime_hist_merge(struct systime_hist *dst, const struct systime_hist *src)
+{
+    unsigned i;
+
+    for(i = 0; i < SYSTIME_HIST_BUCKETS; i++) dst->count[i] += src->count[i];
+    if(src->max > dst->max) dst->max = src->max;
+}
+
+
+
+// returns number of samples
+unsigned long long systime_hist_total(const struct systime_hist *hist)
+{
+    unsigned long long total = 0;
+    unsigned i;
+
+    for(i = 0; i < SYSTIME_HIST_BUCKETS; i++) total += hist->count[i];
+    return total;
+}
+
+
+
+// returns smallest value of bucket index
+unsigned systime_hist_low(unsigned index)
+{
+    unsigned shift;
+
+    if(index < SYSTIME_HIST_SUB) return index;
+
+    shift = (index >> SYSTIME_HIST_SUB_BITS) - 1;
+    return (SYSTIME_HIST_SUB + (index & (SYSTIME_HIST_SUB - 1))) << shift;
+}
+
+
+
+// returns value that ppm parts per million of samples are at or below
+unsigned systime_hist_percentile(const struct systime_hist *hist, unsigned ppm)
+{
+    unsigned long long total = systime_hist_total(hist);
+    unsigned long long rank, sum = 0;
+    unsigned i;
+
+    if(total == 0) return 0;
+
+    // rank of sample, rounded up, from 1 to total
+    rank = (total * (ppm > 1000000U ? 1000000U : ppm) + 999999U) / 1000000U;
+    if(rank == 0) rank = 1;
+
+    for(i = 0; i < SYSTIME_HIST_BUCKETS; i++)
+    {
+        sum += hist->count[i];
+        if(sum >= rank) break;
+    }
+
+    // highest value of bucket, last bucket ends at ~0
+    if(i + 1 < SYSTIME_HIST_BUCKETS)
+    {
+        unsigned high = systime_hist_low(i + 1) - 1;
+        return high < hist->max ? high : hist->max;
+    }
+
+    return hist->max;
+}
@@ -0,0 +1,135 @@
+// systime_hist.h
+
+/*
+    Log-linear latency histogram of tick intervals.
+
+    Values below 2^SYSTIME_HIST_SUB_BITS have bucket each, every higher power of two range
+    is split into 2^SYSTIME_HIST_SUB_BITS equal buckets, so bucket width is at most
+    1 / 2^SYSTIME_HIST_SUB_BITS of its values (12.5 % with default 3) over the whole unsigned
+    range, in fixed table of SYSTIME_HIST_BUCKETS counters. Bucket of value is found from
+    its highest set bit (count leading zeros) and shift, without divide or loop, so
+    systime_hist_add() can be called from interrupt for every sample.
+
+    Histogram has one writer, systime_hist_add() is not locked. Other task reads it with
+    systime_hist_snapshot() while writer keeps running: counters are copied one word at a
+    time, so copy holds all samples added before it started and some of those added during
+    copy, and its total is sum of copied counters. Writer stores max before count and
+    snapshot reads max after all counters, both ordered by systime_sync.h barriers, so
+    max of snapshot is at least every copied sample. Percentiles are computed on snapshot.
+    Snapshots of several histograms (for example one per interrupt or per core) can be
+    added together with systime_hist_merge(). Counters wrap after 2^32 samples of one bucket.
+
+    Example:
+    struct systime_hist isr_hist, snap;
+
+    void adc_isr(void)
+    {
+        systime_hist_elapsed(&isr_hist, adc_trigger_tick);
+        ...
+    }
+
+    systime_hist_snapshot(&snap, &isr_hist);
+    unsigned p99 = systime_hist_percentile(&snap, 990000);
+*/
+
+
+#ifndef __SYSTIME_HIST_H__
+#define __SYSTIME_HIST_H__
+
+#include "systime_tick.h"
+#include "systime_sync.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif // _cplusplus
+
+// log2 of buckets in every power of two range
+#if !defined(SYSTIME_HIST_SUB_BITS)
+#define SYSTIME_HIST_SUB_BITS 3
+#endif // SYSTIME_HIST_SUB_BITS
+
+#define SYSTIME_HIST_SUB (1U << SYSTIME_HIST_SUB_BITS)
+
+// linear range and one range for every higher bit of unsigned
+#define SYSTIME_HIST_BUCKETS ((8 * sizeof(unsigned) - SYSTIME_HIST_SUB_BITS + 1) * SYSTIME_HIST_SUB)
+
+struct systime_hist
+{
+    unsigned count[SYSTIME_HIST_BUCKETS];
+    // largest value added
+    unsigned max;
+};
+
+
+// index of highest set bit of nonzero v
+static inline unsigned systime_hist_msb(unsigned v)
+{
+#if defined(__GNUC__)
+    return 8 * sizeof(unsigned) - 1 - __builtin_clz(v);
+#else
+    unsigned n = 0, shift;
+
+    for(shift = 4 * sizeof(unsigned); shift; shift >>= 1)
+    {
+        if(v >> shift)
+        {
+            v >>= shift;
+            n += shift;
+        }
+    }
+    return n;
+#endif // __GNUC__
+}
+
+// bucket of value
+static inline unsigned systime_hist_index(unsigned value)
+{
+    unsigned shift;
+
+    if(value < SYSTIME_HIST_SUB) return value;
+
+    shift = systime_hist_msb(value) - SYSTIME_HIST_SUB_BITS;
+    return ((shift + 1) << SYSTIME_HIST_SUB_BITS) + ((value >> shift) & (SYSTIME_HIST_SUB - 1));
+}
+
+// add value to histogram, it must be called from one context only
+static inline void systime_hist_add(struct systime_hist *hist, unsigned value)
+{
+    // max is stored before count, so snapshot that copied this sample sees its max
+    if(value > hist->max) hist->max = value;
+    systime_sync_release();
+    hist->count[systime_hist_index(value)]++;
+}
+
+// add ticks elapsed since start to histogram
+#define systime_hist_elapsed(hist, start) systime_hist_add((hist), systime_tick_elapsed(start))
+
+
+// clear all counters, call it from writer context or while writer is stopped
+void systime_hist_reset(struct systime_hist *hist);
+
+// copy hist to snap while writer of hist keeps running
+void systime_hist_snapshot(struct systime_hist *snap, const struct systime_hist *hist);
+
+// add counters of src to dst
+void systime_hist_merge(struct systime_hist *dst, const struct systime_hist *src);
+
+// returns number of samples
+unsigned long long systime_hist_total(const struct systime_hist *hist);
+
+// returns smallest value of bucket index
+unsigned systime_hist_low(unsigned index);
+
+/*
+    returns value that ppm parts per million of samples are at or below (990000 for p99),
+    it is highest value of bucket that holds that sample, at most max. 0 if empty.
+*/
+unsigned systime_hist_percentile(const struct systime_hist *hist, unsigned ppm);
+
+
+
+#ifdef __cplusplus
+}
+#endif // _cplusplus
+
+#endif // __SYSTIME_HIST_H__
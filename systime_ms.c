@@ -1,10 +1,21 @@
 // systime_ms.c
 
 #include "systime_tick.h"
+#include "systime_sync.h"
+#include "systime_stats.h"
 
 // define this if you have integer divide instruction
+// systime_ms_skip() and systime_us_skip() divide 64 by 32 bits in any case, on cores without
+// 64-bit divide it is library call like __aeabi_uldivmod, but only once per skip after sleep
 //#define SYSTEM_TIME_HAVE_DIV_INST
 
+// define this if you don't have integer divide instruction but want constant time
+// conversion using reciprocal multiplication instead of while loops
+//#define SYSTEM_TIME_USE_RECIPROCAL
+
+// conversion selected above
+#include "systime_conv.h"
+
 
 /*
     systime is infrastructure for time measurement on small embedded systems.
@@ -26,48 +37,288 @@
     Note: If tick_multiplier is not 1 there will be some error in miliseconds, but we use
     Bresenham's Algorithm so average error will be 0.
     See https://www.romanblack.com/one_sec.htm
+
+    Note: with fractional rate ticks_for_1ms = num / den, lastsystime_ticks is kept in ticks
+    multiplied by den, so every ms is exactly num of those units and remainder of ms that
+    is not whole yet stays in it. Interval between two calls to systime_ms() must then be
+    less than full unsigned period divided by den.
+
+    systime_us() is converted from ticks the same way with its own rate den, which is
+    reduced fraction of ticks for 1 us.
 */
 
 
 
-static unsigned lastsystime_ticks;
-// we are dividing by ticks1ms so it must not be 0
-static unsigned ticks1ms = 10000;
-#if !defined(SYSTEM_TIME_HAVE_DIV_INST)
-static unsigned ticks50ms;
-#endif // SYSTEM_TIME_HAVE_DIV_INST
+#if !defined(SYSTIME_POSIX)
+
+#if defined(SYSTIME_STATIC_CONFIG)
+
 unsigned systime_curr_ms;
+unsigned systime_static_last_ticks;
+unsigned systime_static_ms64_state;
+#if defined(SYSTIME_STATIC_TICKS_1US)
+unsigned systime_curr_us;
+unsigned systime_static_last_us_ticks;
+#endif // SYSTIME_STATIC_TICKS_1US
 
-// returns current value of miliseconds free running counter
-unsigned systime_ms(void)
-{
-    unsigned now = systime_tick();
+// names used by code shared with runtime configuration, ctx is not used
+#define lastsystime_ticks systime_static_last_ticks
+#define curr_ms systime_curr_ms
+#define ms64_state systime_static_ms64_state
+#define ticks1ms (SYSTIME_STATIC_TICKS_1MS)
+#define ms_den (SYSTIME_STATIC_TICKS_1MS_DEN)
+#define last_us_ticks systime_static_last_us_ticks
+#define curr_us systime_curr_us
+#define ticks1us (SYSTIME_STATIC_TICKS_1US)
+#define us_den (SYSTIME_STATIC_TICKS_1US_DEN)
+#define extend64(state, fcn) systime_extend64(state, fcn)
+#define default_ctx 0
 
-#if defined(SYSTEM_TIME_HAVE_DIV_INST)
-    unsigned diff = (now - lastsystime_ticks) / ticks1ms;
-    systime_curr_ms += diff;
-    lastsystime_ticks += diff * ticks1ms;
 #else
-    // we are using more while loops to have fewer iterations
-    while((now - lastsystime_ticks) > ticks50ms)
-    {
-        lastsystime_ticks += ticks50ms;
-        systime_curr_ms += 50;
-    }
-    while((now - lastsystime_ticks) > ticks1ms)
+
+// names used by code shared with static configuration
+#define lastsystime_ticks (ctx->ms.last)
+#define curr_ms (ctx->ms.curr)
+#define ticks1ms (ctx->ms.div)
+#define ms_den (ctx->ms.den)
+#define last_us_ticks (ctx->us.last)
+#define curr_us (ctx->us.curr)
+#define ticks1us (ctx->us.div)
+#define us_den (ctx->us.den)
+#define ms64_state (ctx->ms64_state)
+#define extend64(state, fcn) systime_extend64_ctx(state, fcn##_ctx, ctx)
+#define default_ctx (&systime_ctx_default)
+
+// advances counter of rate to tick count now and returns it
+static unsigned rate_update(struct systime_rate *rate, unsigned now)
+{
+    return systime_conv_update(&rate->last, &rate->curr, now * rate->den, rate->div, rate->div50, rate->recip, 0);
+}
+
+
+
+// set rate to num / den ticks for one unit at tick count now
+static void rate_init(struct systime_rate *rate, unsigned now, unsigned num, unsigned den)
+{
+    // with the same den boundary of last whole unit stays, so rate can be slewed without
+    // losing phase, else part of unit that is not whole yet is dropped
+    int keep = rate->div && rate->den == den;
+
+    // finish units at old rate, new context has no rate yet and nothing to finish
+    if(rate->div) rate_update(rate, now);
+
+    rate->div = num;
+    rate->den = den;
+#if defined(SYSTEM_TIME_USE_RECIPROCAL) && !defined(SYSTEM_TIME_HAVE_DIV_INST)
+    // only divide is here, once at init
+    rate->recip = ~0U / num;
+#elif !defined(SYSTEM_TIME_HAVE_DIV_INST)
+    rate->div50 = 50 * num;
+#endif // SYSTEM_TIME_HAVE_DIV_INST
+
+    if(!keep) rate->last = now * den;
+}
+
+
+
+// greatest common divisor, init only
+static unsigned gcd(unsigned a, unsigned b)
+{
+    while(b)
     {
-        lastsystime_ticks += ticks1ms;
-        systime_curr_ms++;
+        unsigned t = a % b;
+        a = b;
+        b = t;
     }
-#endif  // SYSTEM_TIME_HAVE_DIV_INST
 
-    return systime_curr_ms;
+    return a;
+}
+
+
+
+// advances ms counter, ms only move here, so epoch of systime_ms64() is kept current
+static unsigned ms_update(struct systime_ctx *ctx, unsigned now)
+{
+    unsigned ext = systime_sync_load(&ms64_state);
+    unsigned ms = rate_update(&ctx->ms, now);
+
+    systime_sync_extend64(&ms64_state, ext, ms);
+    return ms;
+}
+
+
+
+// returns current value of miliseconds free running counter
+unsigned systime_ms_ctx(struct systime_ctx *ctx)
+{
+    systime_stat_inc(ms_calls);
+    return ms_update(ctx, systime_tick_ctx(ctx));
+}
+
+
+
+// advances miliseconds counter to tick count now and returns it
+unsigned systime_ms_update_ctx(struct systime_ctx *ctx, unsigned now)
+{
+    systime_stat_inc(ms_calls);
+    return ms_update(ctx, now);
+}
+
+
+
+unsigned systime_ms(void)
+{
+    return systime_ms_ctx(&systime_ctx_default);
+}
+
+
+
+unsigned systime_ms_update(unsigned now)
+{
+    return systime_ms_update_ctx(&systime_ctx_default, now);
+}
+
+
+
+// returns current value of microseconds free running counter
+unsigned systime_us_ctx(struct systime_ctx *ctx)
+{
+    systime_stat_inc(us_calls);
+    return rate_update(&ctx->us, systime_tick_ctx(ctx));
+}
+
+
+
+// advances microseconds counter to tick count now and returns it
+unsigned systime_us_update_ctx(struct systime_ctx *ctx, unsigned now)
+{
+    systime_stat_inc(us_calls);
+    return rate_update(&ctx->us, now);
+}
+
+
+
+unsigned systime_us(void)
+{
+    return systime_us_ctx(&systime_ctx_default);
+}
+
+
+
+unsigned systime_us_update(unsigned now)
+{
+    systime_stat_inc(us_calls);
+    return rate_update(&systime_ctx_default.us, now);
+}
+
+#endif // SYSTIME_STATIC_CONFIG
+
+
+
+/*
+    account for ticks elapsed while counter was not updated, returns number of units added.
+    last and curr are boundary and counter, div / den is number of ticks for one unit.
+    Remainder is converted by next update. New counter value is stored to value.
+    Skipped ticks can be more than 32 bits, so this is 64 by 32 bit divide regardless of
+    SYSTEM_TIME_HAVE_DIV_INST, it is called once after sleep, not on every update.
+*/
+static unsigned long long ticks_skip(unsigned *last, unsigned *curr, unsigned div, unsigned den, unsigned long long ticks, unsigned *value)
+{
+    unsigned long long q = ticks * den / div;
+    unsigned old = systime_sync_load(last);
+
+    while(!systime_sync_cas(last, &old, old + (unsigned)q * div));
+    *value = systime_sync_add(curr, (unsigned)q) + (unsigned)q;
+
+    return q;
+}
+
+
+
+// returns current value of miliseconds free running counter extended to 64 bits.
+// every ms update keeps extension current, see systime_ms64() in systime_tick.h.
+static unsigned long long ms64(struct systime_ctx *ctx)
+{
+    (void)ctx;
+    return extend64(&ms64_state, systime_ms);
+}
+
+
+
+// account for ticks elapsed while systime_ms() was not called, returns number of ms added
+static unsigned long long ms_skip(struct systime_ctx *ctx, unsigned long long ticks)
+{
+    unsigned ms;
+    unsigned long long q = ticks_skip(&lastsystime_ticks, &curr_ms, ticks1ms, ms_den, ticks, &ms);
+
+    (void)ctx;
+    systime_extend64_skip(&ms64_state, ms, q);
+    return q;
+}
+
+
+
+unsigned long long systime_ms64(void)
+{
+    return ms64(default_ctx);
+}
+
+
+
+unsigned long long systime_ms_skip(unsigned long long ticks)
+{
+    return ms_skip(default_ctx, ticks);
+}
+
+
+
+#if !defined(SYSTIME_STATIC_CONFIG) || defined(SYSTIME_STATIC_TICKS_1US)
+
+// account for ticks elapsed while systime_us() was not called, returns number of us added
+static unsigned long long us_skip(struct systime_ctx *ctx, unsigned long long ticks)
+{
+    unsigned us;
+
+    (void)ctx;
+    return ticks_skip(&last_us_ticks, &curr_us, ticks1us, us_den, ticks, &us);
 }
 
 
+
+unsigned long long systime_us_skip(unsigned long long ticks)
+{
+    return us_skip(default_ctx, ticks);
+}
+
+#endif // SYSTIME_STATIC_TICKS_1US
+
+
+#if !defined(SYSTIME_STATIC_CONFIG)
+
 //##############################################################################################
 
 
+unsigned long long systime_ms64_ctx(struct systime_ctx *ctx)
+{
+    return ms64(ctx);
+}
+
+
+
+unsigned long long systime_ms_skip_ctx(struct systime_ctx *ctx, unsigned long long ticks)
+{
+    return ms_skip(ctx, ticks);
+}
+
+
+
+unsigned long long systime_us_skip_ctx(struct systime_ctx *ctx, unsigned long long ticks)
+{
+    return us_skip(ctx, ticks);
+}
+
+
+
 /*
     initialize systime time
 
@@ -88,13 +339,90 @@ unsigned systime_ms(void)
     we use Bresenham's Algorithm so average error will be 0.
     See https://www.romanblack.com/one_sec.htm
 */
+void systime_time_init_ctx(struct systime_ctx *ctx, unsigned ticks_for_1ms)
+{
+    systime_time_init_frac_ctx(ctx, ticks_for_1ms, 1);
+}
+
+
+
 void systime_time_init(unsigned ticks_for_1ms)
 {
-    ticks1ms = ticks_for_1ms;
-#if ! defined(SYSTEM_TIME_HAVE_DIV_INST)
-    ticks50ms = 50 * ticks_for_1ms;
-#endif // SYSTEM_TIME_HAVE_DIV_INST
+    systime_time_init_ctx(&systime_ctx_default, ticks_for_1ms);
+}
+
+
+
+/*
+    initialize systime time with fractional rate, num / den internal ticks for 1 milisecond.
+
+    Fraction of ms is carried from one ms to next, so tick_multiplier can stay 1 and
+    systime_tick() wraps den times later than with tick_multiplier den.
+    num must not be 0 and den * full timer period must fit in unsigned.
+
+    It can be called again to change rate, for example after calibration. If den is not
+    changed phase of current ms is kept and counters never jump.
+
+    Example: timer clock is 11.0592MHz, timer register is 16 bits and unsigned is 32 bits
+    systime_tick_init(timer_read, 16, 1):
+    systime_time_init_frac(110592, 10);
+*/
+void systime_time_init_frac_ctx(struct systime_ctx *ctx, unsigned num, unsigned den)
+{
+    unsigned now = systime_tick_ctx(ctx);
+    // us rate num / (den * 1000) is reduced so us can be updated less often
+    unsigned g = gcd(num, den * 1000);
+
+    rate_init(&ctx->ms, now, num, den);
+    rate_init(&ctx->us, now, num / g, den * 1000 / g);
+}
+
+
+
+void systime_time_init_frac(unsigned num, unsigned den)
+{
+    systime_time_init_frac_ctx(&systime_ctx_default, num, den);
+}
+
 
-    systime_ms();
+
+/*
+    change only ms rate to num / den ticks for 1 ms, us rate set by init is kept.
+
+    Used by calibration, which changes rate often with large den. us rate stays
+    integer or small fraction, so systime_us() call interval does not shrink by den
+    and partial us is not dropped by every change.
+*/
+void systime_time_ms_rate_ctx(struct systime_ctx *ctx, unsigned num, unsigned den)
+{
+    rate_init(&ctx->ms, systime_tick_ctx(ctx), num, den);
 }
 
+
+
+/*
+    initialize systime time with internal tick rate in Hz.
+
+    Rate is reduced to fraction ticks_hz / 1000 ticks for 1 milisecond.
+
+    Example: timer clock is 11.0592MHz, timer register is 16 bits and unsigned is 32 bits
+    systime_tick_init(timer_read, 16, 1):
+    systime_time_init_hz(11059200);     // 55296 / 5 ticks for 1 ms
+*/
+void systime_time_init_hz_ctx(struct systime_ctx *ctx, unsigned ticks_hz)
+{
+    unsigned g = gcd(ticks_hz, 1000);
+
+    systime_time_init_frac_ctx(ctx, ticks_hz / g, 1000 / g);
+}
+
+
+
+void systime_time_init_hz(unsigned ticks_hz)
+{
+    systime_time_init_hz_ctx(&systime_ctx_default, ticks_hz);
+}
+
+#endif // SYSTIME_STATIC_CONFIG
+
+#endif // SYSTIME_POSIX
@@ -0,0 +1,36 @@
+// systime_now.c
+
+#include "systime_tick.h"
+
+
+/*
+    Snapshot of all systime counters.
+
+    systime_tick(), systime_ms() and systime_sec() called one after another read timer
+    three times and values can straddle ms or second boundary. systime_now() reads timer
+    once and derives ms and seconds from that same tick count.
+*/
+
+
+
+// reads timer only once and coherently updates and returns ticks, ms and seconds
+void systime_now(struct systime_snapshot *now)
+{
+    now->ticks = systime_tick();
+    now->ms = systime_ms_update(now->ticks);
+    now->sec = systime_sec_update(now->ms);
+}
+
+
+
+#if defined(SYSTIME_HAVE_CTX)
+
+// the same for time base ctx
+void systime_now_ctx(struct systime_ctx *ctx, struct systime_snapshot *now)
+{
+    now->ticks = systime_tick_ctx(ctx);
+    now->ms = systime_ms_update_ctx(ctx, now->ticks);
+    now->sec = systime_sec_update_ctx(ctx, now->ms);
+}
+
+#endif // SYSTIME_HAVE_CTX
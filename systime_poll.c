@@ -0,0 +1,87 @@
+// systime_poll.c
+
+#include "systime_poll.h"
+#include "systime_tick.h"
+
+// largest slack, checks at most twice slack apart stay within half of unsigned period
+#define SLACK_MAX (1U << (8 * sizeof(unsigned) - 2))
+
+
+
+static unsigned slack_of(unsigned long long timeout)
+{
+    timeout /= SYSTIME_POLL_SLACK_DIV;
+    if(timeout > SLACK_MAX) return SLACK_MAX;
+    return timeout ? (unsigned)timeout : 1;
+}
+
+
+
+//##############################################################################################
+
+
+// start polling with timeout ticks, timeout is detected at most slack ticks late
+void systime_poll_start(struct systime_poll *poll, unsigned long long timeout, unsigned slack)
+{
+    poll->count = 1;
+    poll->stride = 1;
+    poll->slack = slack > SLACK_MAX ? SLACK_MAX : (slack ? slack : 1);
+    poll->elapsed = 0;
+    poll->timeout = timeout;
+    poll->last = systime_tick();
+}
+
+
+
+// start polling with timeout in miliseconds and slack of timeout / SYSTIME_POLL_SLACK_DIV
+void systime_poll_start_ms(struct systime_poll *poll, unsigned timeout_ms)
+{
+    unsigned long long ticks = ((unsigned long long)timeout_ms * systime_ticks_1ms_num() + systime_ticks_1ms_den() - 1) / systime_ticks_1ms_den();
+
+    systime_poll_start(poll, ticks, slack_of(ticks));
+}
+
+
+
+// start polling with timeout in microseconds and slack of timeout / SYSTIME_POLL_SLACK_DIV
+void systime_poll_start_us(struct systime_poll *poll, unsigned timeout_us)
+{
+    unsigned long long den = systime_ticks_1ms_den() * 1000ULL;
+    unsigned long long ticks = ((unsigned long long)timeout_us * systime_ticks_1ms_num() + den - 1) / den;
+
+    systime_poll_start(poll, ticks, slack_of(ticks));
+}
+
+
+
+// reads time, returns nonzero if timeout expired, systime_poll_expired() calls it every stride iterations
+int systime_poll_check(struct systime_poll *poll)
+{
+    unsigned now = systime_tick();
+    unsigned gap = now - poll->last;
+    unsigned long long left, target, stride;
+
+    poll->last = now;
+    poll->elapsed += gap;
+
+    if(poll->elapsed >= poll->timeout)
+    {
+        // stays expired on next call
+        poll->count = 1;
+        return 1;
+    }
+
+    // next check at most slack and at most time left from now
+    left = poll->timeout - poll->elapsed;
+    target = left < poll->slack ? left : poll->slack;
+
+    // iterations for target ticks at measured cost, at most twice as many as before
+    stride = 2ULL * poll->stride;
+    if(gap > 0 && target * poll->stride / gap < stride) stride = target * poll->stride / gap;
+    if(stride > SYSTIME_POLL_STRIDE_MAX) stride = SYSTIME_POLL_STRIDE_MAX;
+    if(stride < 1) stride = 1;
+
+    poll->stride = (unsigned)stride;
+    poll->count = poll->stride;
+    return 0;
+}
@@ -0,0 +1,87 @@
+// systime_poll.h
+
+/*
+    Timeout of polling loops that reads time only every few iterations.
+
+    Driver loop like while(!ready() && !systime_ms_expired(start, timeout)) spends most of
+    its time in systime_ms() when status register read is cheaper than timer read and
+    conversion. systime_poll_expired() only decrements counter and calls systime_tick() once
+    every stride iterations. Stride is tuned at every check from measured ticks per
+    iteration, so that time between checks is at most slack and at most time left to
+    timeout. Near timeout checks get denser, and timeout is detected at most slack ticks
+    late as long as cost of one iteration doesn't grow more than twice between checks
+    (stride grows at most twice per check). Interrupts during loop extend it by their run
+    time like any other loop.
+
+    First check is after first iteration, it measures loop cost. Elapsed ticks are
+    accumulated in 64 bits, so timeout can be longer than systime_tick() period, only
+    slack is limited to quarter of it. systime_poll_start_ms() and systime_poll_start_us()
+    convert timeout to ticks at start, after rate of time base changes (systime_calib_ref())
+    start polling again.
+
+    Example:
+    struct systime_poll poll;
+    systime_poll_start_ms(&poll, 10);
+    while(!(SPI1->SR & SPI_SR_TXE))
+        if(systime_poll_expired(&poll)) return -1;
+*/
+
+
+#ifndef __SYSTIME_POLL_H__
+#define __SYSTIME_POLL_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif // _cplusplus
+
+// slack of systime_poll_start_ms() and systime_poll_start_us() is timeout / SYSTIME_POLL_SLACK_DIV
+#if !defined(SYSTIME_POLL_SLACK_DIV)
+#define SYSTIME_POLL_SLACK_DIV 16
+#endif // SYSTIME_POLL_SLACK_DIV
+
+// maximum iterations between checks
+#if !defined(SYSTIME_POLL_STRIDE_MAX)
+#define SYSTIME_POLL_STRIDE_MAX (1U << 20)
+#endif // SYSTIME_POLL_STRIDE_MAX
+
+struct systime_poll
+{
+    // iterations left to next check
+    unsigned count;
+    // iterations between checks
+    unsigned stride;
+    // systime_tick() of last check
+    unsigned last;
+    // allowed ticks between checks
+    unsigned slack;
+    unsigned long long elapsed;
+    unsigned long long timeout;
+};
+
+
+// start polling with timeout ticks, timeout is detected at most slack ticks late
+void systime_poll_start(struct systime_poll *poll, unsigned long long timeout, unsigned slack);
+
+// start polling with timeout in miliseconds and slack of timeout / SYSTIME_POLL_SLACK_DIV
+void systime_poll_start_ms(struct systime_poll *poll, unsigned timeout_ms);
+
+// start polling with timeout in microseconds and slack of timeout / SYSTIME_POLL_SLACK_DIV
+void systime_poll_start_us(struct systime_poll *poll, unsigned timeout_us);
+
+// reads time, returns nonzero if timeout expired, systime_poll_expired() calls it every stride iterations
+int systime_poll_check(struct systime_poll *poll);
+
+// call once every loop iteration, returns nonzero if timeout expired
+static inline int systime_poll_expired(struct systime_poll *poll)
+{
+    if(--poll->count) return 0;
+    return systime_poll_check(poll);
+}
+
+
+
+#ifdef __cplusplus
+}
+#endif // _cplusplus
+
+#endif // __SYSTIME_POLL_H__
@@ -0,0 +1,380 @@
+// systime_posix.c
+
+// clock_gettime() and clockid_t are POSIX, they are hidden by strict -std=c11 without it
+#if !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 199309L
+#endif // _POSIX_C_SOURCE
+
+#include "systime_tick.h"
+
+/*
+    Host backend of systime for Linux and other POSIX systems.
+
+    Define SYSTIME_POSIX for all systime files and link this file, systime_tick.c,
+    systime_ms.c and systime_sec.c are then empty. systime_tick(), systime_ms(),
+    systime_us() and systime_sec() are read directly from clock_gettime(), which is
+    vDSO call without syscall on Linux, so there is no tick accumulation or conversion
+    loop and time is never lost however rarely systime is called.
+
+    One tick is 1 ns of SYSTIME_POSIX_CLOCK (CLOCK_MONOTONIC). All counters are low
+    word of 64-bit count since clock start, so they wrap with full unsigned period like
+    on target and the same elapsed / expired macros work. Coarse reads use
+    SYSTIME_POSIX_CLOCK_COARSE (CLOCK_MONOTONIC_COARSE), which is faster and has
+    resolution of kernel tick. Wall clock systime_sec() is monotonic seconds with offset
+    set by systime_sec_set() and slew of systime_adjust(), they are kept with sequence lock
+    so they can be changed while other threads read time.
+
+    There are no time base contexts (_ctx functions) in this configuration.
+    systime_tick_init(), systime_time_init(), systime_time_init_frac() and
+    systime_time_init_hz() do nothing, so target init code builds unchanged.
+    systime_sleep_resync() and skip functions do nothing too, clock keeps counting
+    while process is not running.
+*/
+
+#if defined(SYSTIME_POSIX)
+
+#include <time.h>
+
+// clock for ticks, ms, us and seconds
+#if !defined(SYSTIME_POSIX_CLOCK)
+#define SYSTIME_POSIX_CLOCK CLOCK_MONOTONIC
+#endif // SYSTIME_POSIX_CLOCK
+
+// clock for coarse reads, it must count the same time as SYSTIME_POSIX_CLOCK
+#if !defined(SYSTIME_POSIX_CLOCK_COARSE)
+#if defined(CLOCK_MONOTONIC_COARSE)
+#define SYSTIME_POSIX_CLOCK_COARSE CLOCK_MONOTONIC_COARSE
+#else
+#define SYSTIME_POSIX_CLOCK_COARSE SYSTIME_POSIX_CLOCK
+#endif // CLOCK_MONOTONIC_COARSE
+#endif // SYSTIME_POSIX_CLOCK_COARSE
+
+
+// wall clock offset and slew, see systime_adjust()
+struct wall
+{
+    // seconds added to monotonic seconds by systime_sec_set()
+    unsigned offset_sec;
+    // ms of finished slews
+    long long slew_base;
+    // slew in progress, total ms applied as 1 ms every interval ms since start
+    int slew_total;
+    unsigned long long slew_start;
+    unsigned long long slew_interval;
+};
+
+static struct wall wall;
+// odd while wall is being changed
+static unsigned wall_seq;
+
+
+
+static unsigned long long clock_ns(clockid_t id)
+{
+    struct timespec ts;
+
+    clock_gettime(id, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+}
+
+
+
+// 64-bit ns count whose low word is tick, tick must be less than half period from now
+static unsigned long long ns_at(unsigned tick)
+{
+    unsigned long long now = clock_ns(SYSTIME_POSIX_CLOCK);
+    return now + (unsigned long long)(long long)(int)(tick - (unsigned)now);
+}
+
+
+
+// 64-bit ms count whose low word is ms, ms must be less than half period from now
+static unsigned long long ms_at(unsigned ms)
+{
+    unsigned long long now = clock_ns(SYSTIME_POSIX_CLOCK) / 1000000ULL;
+    return now + (unsigned long long)(long long)(int)(ms - (unsigned)now);
+}
+
+
+
+static void wall_read(struct wall *w)
+{
+    unsigned seq;
+
+    do
+    {
+        seq = __atomic_load_n(&wall_seq, __ATOMIC_ACQUIRE);
+        *w = wall;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    }
+    while((seq & 1) || seq != __atomic_load_n(&wall_seq, __ATOMIC_RELAXED));
+}
+
+
+
+static void wall_lock(void)
+{
+    unsigned seq = __atomic_load_n(&wall_seq, __ATOMIC_RELAXED);
+
+    while((seq & 1) || !__atomic_compare_exchange_n(&wall_seq, &seq, seq + 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        seq = __atomic_load_n(&wall_seq, __ATOMIC_RELAXED);
+}
+
+
+
+static void wall_unlock(void)
+{
+    __atomic_fetch_add(&wall_seq, 1, __ATOMIC_RELEASE);
+}
+
+
+
+// ms of slew applied at monotonic ms count ms
+static long long wall_slew(const struct wall *w, unsigned long long ms)
+{
+    unsigned long long left, due;
+
+    if(w->slew_total == 0 || ms < w->slew_start) return w->slew_base;
+
+    left = w->slew_total < 0 ? 0U - (unsigned)w->slew_total : (unsigned)w->slew_total;
+    due = (ms - w->slew_start) / w->slew_interval;
+    if(due > left) due = left;
+
+    return w->slew_base + (w->slew_total < 0 ? -(long long)due : (long long)due);
+}
+
+
+
+// wall clock seconds at monotonic ms count ms
+static unsigned long long wall_sec(const struct wall *w, unsigned long long ms)
+{
+    long long t = (long long)ms + wall_slew(w, ms);
+    long long q = t / 1000;
+
+    // floor, slew back can be more than time since clock start
+    if(t < q * 1000) q--;
+    return (unsigned long long)q + w->offset_sec;
+}
+
+
+
+//##############################################################################################
+
+
+// clock rate is fixed, init of target code has nothing to set
+void systime_tick_init(unsigned (*fcn)(void), unsigned hw_bits, unsigned tick_multiplier)
+{
+    (void)fcn;
+    (void)hw_bits;
+    (void)tick_multiplier;
+}
+
+
+
+void systime_time_init(unsigned ticks_for_1ms)
+{
+    (void)ticks_for_1ms;
+}
+
+
+
+void systime_time_init_frac(unsigned num, unsigned den)
+{
+    (void)num;
+    (void)den;
+}
+
+
+
+void systime_time_init_hz(unsigned ticks_hz)
+{
+    (void)ticks_hz;
+}
+
+
+
+unsigned systime_tick(void)
+{
+    return (unsigned)clock_ns(SYSTIME_POSIX_CLOCK);
+}
+
+
+
+unsigned long long systime_tick64(void)
+{
+    return clock_ns(SYSTIME_POSIX_CLOCK);
+}
+
+
+
+unsigned systime_ms(void)
+{
+    return (unsigned)(clock_ns(SYSTIME_POSIX_CLOCK) / 1000000ULL);
+}
+
+
+
+// miliseconds at tick count now ( result of systime_tick() )
+unsigned systime_ms_update(unsigned now)
+{
+    return (unsigned)(ns_at(now) / 1000000ULL);
+}
+
+
+
+unsigned long long systime_ms64(void)
+{
+    return clock_ns(SYSTIME_POSIX_CLOCK) / 1000000ULL;
+}
+
+
+
+unsigned systime_us(void)
+{
+    return (unsigned)(clock_ns(SYSTIME_POSIX_CLOCK) / 1000ULL);
+}
+
+
+
+// microseconds at tick count now ( result of systime_tick() )
+unsigned systime_us_update(unsigned now)
+{
+    return (unsigned)(ns_at(now) / 1000ULL);
+}
+
+
+
+unsigned systime_sec(void)
+{
+    struct wall w;
+
+    wall_read(&w);
+    return (unsigned)wall_sec(&w, systime_ms64());
+}
+
+
+
+// wall clock seconds at miliseconds count now ( result of systime_ms() )
+unsigned systime_sec_update(unsigned now)
+{
+    struct wall w;
+
+    wall_read(&w);
+    return (unsigned)wall_sec(&w, ms_at(now));
+}
+
+
+
+unsigned long long systime_sec64(void)
+{
+    struct wall w;
+
+    wall_read(&w);
+    return wall_sec(&w, systime_ms64());
+}
+
+
+
+unsigned systime_sec_mono(void)
+{
+    return (unsigned)(clock_ns(SYSTIME_POSIX_CLOCK) / 1000000000ULL);
+}
+
+
+
+void systime_sec_set(unsigned current_time)
+{
+    wall_lock();
+    // adding difference modulo full unsigned steps both forward and backward
+    wall.offset_sec += current_time - (unsigned)wall_sec(&wall, systime_ms64());
+    wall_unlock();
+}
+
+
+
+void systime_adjust(int delta_ms, unsigned period_sec)
+{
+    unsigned long long ms = systime_ms64();
+    unsigned left = delta_ms < 0 ? 0U - (unsigned)delta_ms : (unsigned)delta_ms;
+    unsigned long long period = (unsigned long long)period_sec * 1000U;
+
+    // at most 1 ms correction for every ms
+    if(period < left) period = left;
+
+    wall_lock();
+    // slew in progress is kept as far as it got
+    wall.slew_base = wall_slew(&wall, ms);
+    wall.slew_total = delta_ms;
+    wall.slew_start = ms;
+    wall.slew_interval = left ? period / left : 1;
+    wall_unlock();
+}
+
+
+
+int systime_adjust_remaining(void)
+{
+    struct wall w;
+
+    wall_read(&w);
+    return w.slew_total - (int)(wall_slew(&w, systime_ms64()) - w.slew_base);
+}
+
+
+
+// clock counts all time, nothing is lost
+unsigned long long systime_tick_skip(unsigned long long elapsed)
+{
+    (void)elapsed;
+    return 0;
+}
+
+
+
+unsigned long long systime_ms_skip(unsigned long long ticks)
+{
+    (void)ticks;
+    return 0;
+}
+
+
+
+unsigned long long systime_us_skip(unsigned long long ticks)
+{
+    (void)ticks;
+    return 0;
+}
+
+
+
+unsigned long long systime_sec_skip(unsigned long long ms)
+{
+    (void)ms;
+    return 0;
+}
+
+
+
+unsigned systime_ms_coarse(void)
+{
+    return (unsigned)(clock_ns(SYSTIME_POSIX_CLOCK_COARSE) / 1000000ULL);
+}
+
+
+
+unsigned systime_sec_coarse(void)
+{
+    struct wall w;
+
+    wall_read(&w);
+    return (unsigned)wall_sec(&w, clock_ns(SYSTIME_POSIX_CLOCK_COARSE) / 1000000ULL);
+}
+
+
+
+// coarse clock is updated by kernel
+void systime_coarse_update(void)
+{
+}
+
+#endif // SYSTIME_POSIX
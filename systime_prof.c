@@ -0,0 +1,90 @@
+// systime_prof.c
+
+#include "systime_prof.h"
+
+#if defined(SYSTIME_PROFILE)
+
+// number of empty probes used to measure overhead
+#define OVERHEAD_RUNS 16
+
+struct systime_prof_slot systime_prof_table[SYSTIME_PROFILE_SLOTS];
+
+// ticks of empty probe, subtracted from every measurement
+static unsigned overhead;
+
+
+
+// measure probe overhead and reset all slots
+void systime_prof_init(void)
+{
+    unsigned i;
+
+    // minimum is probe cost when it is not disturbed by interrupts
+    overhead = ~0U;
+    for(i = 0; i < OVERHEAD_RUNS; i++)
+    {
+        unsigned start = systime_tick();
+        unsigned ticks = systime_tick() - start;
+        if(ticks < overhead) overhead = ticks;
+    }
+
+    systime_prof_reset();
+}
+
+
+
+// set name of slot, name is not copied
+void systime_prof_name(unsigned slot, const char *name)
+{
+    if(slot < SYSTIME_PROFILE_SLOTS) systime_prof_table[slot].name = name;
+}
+
+
+
+// add measurement of ticks to slot, probe overhead is subtracted
+void systime_prof_add(unsigned slot, unsigned ticks)
+{
+    struct systime_prof_slot *s;
+
+    if(slot >= SYSTIME_PROFILE_SLOTS) return;
+    s = &systime_prof_table[slot];
+
+    ticks = (ticks > overhead) ? ticks - overhead : 0;
+
+    if(s->count == 0 || ticks < s->min) s->min = ticks;
+    if(ticks > s->max) s->max = ticks;
+    s->total += ticks;
+    s->count++;
+}
+
+
+
+// call print for every slot with at least one measurement
+void systime_prof_dump(void (*print)(unsigned slot, const struct systime_prof_slot *s))
+{
+    unsigned slot;
+
+    for(slot = 0; slot < SYSTIME_PROFILE_SLOTS; slot++)
+    {
+        if(systime_prof_table[slot].count) print(slot, &systime_prof_table[slot]);
+    }
+}
+
+
+
+// reset measurements of all slots, names are kept
+void systime_prof_reset(void)
+{
+    unsigned slot;
+
+    for(slot = 0; slot < SYSTIME_PROFILE_SLOTS; slot++)
+    {
+        struct systime_prof_slot *s = &systime_prof_table[slot];
+        s->count = 0;
+        s->min = 0;
+        s->max = 0;
+        s->total = 0;
+    }
+}
+
+#endif // SYSTIME_PROFILE
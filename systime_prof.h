@@ -0,0 +1,97 @@
+// systime_prof.h
+
+/*
+    Profiling probes on top of systime_tick().
+
+    Every probe slot accumulates count, total, min and max of ticks measured between
+    systime_prof_begin() and systime_prof_end(). Slots are fixed size static table.
+    Overhead of probe itself is measured in systime_prof_init() and subtracted from
+    every measurement.
+
+    Probes are compiled only if SYSTIME_PROFILE is defined, otherwise all macros are empty.
+
+    Example:
+    systime_prof_init();
+    systime_prof_name(0, "adc");
+
+    void adc_isr(void)
+    {
+        systime_prof_begin(0);
+        ...
+        systime_prof_end(0);
+    }
+
+    systime_prof_dump(print_slot);
+
+    Probes of one slot must be used from one context only.
+*/
+
+
+#ifndef __SYSTIME_PROF_H__
+#define __SYSTIME_PROF_H__
+
+#include "systime_tick.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif // _cplusplus
+
+// number of probe slots
+#if !defined(SYSTIME_PROFILE_SLOTS)
+#define SYSTIME_PROFILE_SLOTS 16
+#endif // SYSTIME_PROFILE_SLOTS
+
+struct systime_prof_slot
+{
+    const char *name;
+    unsigned count;
+    unsigned min;
+    unsigned max;
+    unsigned long long total;
+};
+
+
+#if defined(SYSTIME_PROFILE)
+
+extern struct systime_prof_slot systime_prof_table[SYSTIME_PROFILE_SLOTS];
+
+// measure probe overhead and reset all slots
+void systime_prof_init(void);
+
+// set name of slot, name is not copied
+void systime_prof_name(unsigned slot, const char *name);
+
+// add measurement of ticks to slot, probe overhead is subtracted
+void systime_prof_add(unsigned slot, unsigned ticks);
+
+// call print for every slot with at least one measurement
+void systime_prof_dump(void (*print)(unsigned slot, const struct systime_prof_slot *s));
+
+// reset measurements of all slots, names are kept
+void systime_prof_reset(void);
+
+// start measurement, slot must be integer constant or identifier
+#define systime_prof_begin(slot) unsigned systime_prof_start_##slot = systime_tick()
+
+// end measurement started with systime_prof_begin() in the same block
+#define systime_prof_end(slot) systime_prof_add((slot), systime_tick() - systime_prof_start_##slot)
+
+#else
+
+#define systime_prof_init() ((void)0)
+#define systime_prof_name(slot, name) ((void)0)
+#define systime_prof_add(slot, ticks) ((void)0)
+#define systime_prof_dump(print) ((void)0)
+#define systime_prof_reset() ((void)0)
+#define systime_prof_begin(slot)
+#define systime_prof_end(slot) ((void)0)
+
+#endif // SYSTIME_PROFILE
+
+
+
+#ifdef __cplusplus
+}
+#endif // _cplusplus
+
+#endif // __SYSTIME_PROF_H__
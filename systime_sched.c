@@ -0,0 +1,195 @@
+// systime_sched.c
+
+#include "systime_sched.h"
+#include "systime_serial.h"
+
+
+
+static void heap_set(struct systime_sched *sched, unsigned i, struct systime_task *task)
+{
+    sched->heap[i] = task;
+    task->slot = i + 1;
+}
+
+
+
+// move task at i toward root while its deadline is before its parent
+static void sift_up(struct systime_sched *sched, unsigned i)
+{
+    struct systime_task *task = sched->heap[i];
+
+    while(i > 0)
+    {
+        unsigned parent = (i - 1) / 2;
+        if(!systime_before(task->deadline, sched->heap[parent]->deadline)) break;
+        heap_set(sched, i, sched->heap[parent]);
+        i = parent;
+    }
+
+    heap_set(sched, i, task);
+}
+
+
+
+// move task at i toward leaves while some child has earlier deadline
+static void sift_down(struct systime_sched *sched, unsigned i)
+{
+    struct systime_task *task = sched->heap[i];
+
+    for(;;)
+    {
+        unsigned child = 2 * i + 1;
+
+        if(child >= sched->count) break;
+        if(child + 1 < sched->count &&
+            systime_before(sched->heap[child + 1]->deadline, sched->heap[child]->deadline)) child++;
+        if(!systime_before(sched->heap[child]->deadline, task->deadline)) break;
+
+        heap_set(sched, i, sched->heap[child]);
+        i = child;
+    }
+
+    heap_set(sched, i, task);
+}
+
+
+
+static void heap_remove(struct systime_sched *sched, struct systime_task *task)
+{
+    unsigned i = task->slot - 1;
+    struct systime_task *last = sched->heap[--sched->count];
+
+    task->slot = 0;
+    if(last == task) return;
+
+    heap_set(sched, i, last);
+    sift_up(sched, i);
+    sift_down(sched, last->slot - 1);
+}
+
+
+
+//##############################################################################################
+
+
+// initialize scheduler, now is time function (systime_ms, systime_tick, ...), heap has size entries
+void systime_sched_init(struct systime_sched *sched, unsigned (*now)(void), struct systime_task **heap, unsigned size)
+{
+    sched->now = now;
+    sched->heap = heap;
+    sched->size = size;
+    sched->count = 0;
+}
+
+
+
+// initialize task, overrun statistics are cleared
+void systime_task_init(struct systime_task *task, systime_task_fcn fcn, void *arg)
+{
+    task->fcn = fcn;
+    task->arg = arg;
+    task->deadline = 0;
+    task->period = 0;
+    task->slot = 0;
+    task->overruns = 0;
+    task->late_max = 0;
+}
+
+
+
+/*
+    schedule task delay after now, then every period, period 0 for one-shot task.
+    Task is rescheduled if it is already scheduled. Returns 0 if heap is full.
+*/
+int systime_sched_add(struct systime_sched *sched, struct systime_task *task, unsigned delay, unsigned period)
+{
+    task->deadline = sched->now() + delay;
+    task->period = period;
+
+    if(systime_task_scheduled(task))
+    {
+        sift_up(sched, task->slot - 1);
+        sift_down(sched, task->slot - 1);
+        return 1;
+    }
+
+    if(sched->count == sched->size) return 0;
+
+    heap_set(sched, sched->count, task);
+    sift_up(sched, sched->count++);
+    return 1;
+}
+
+
+
+// remove task if it is scheduled
+void systime_sched_cancel(struct systime_sched *sched, struct systime_task *task)
+{
+    if(systime_task_scheduled(task)) heap_remove(sched, task);
+}
+
+
+
+// returns time until next task, 0 if some task is due or SYSTIME_SCHED_NONE
+unsigned systime_sched_next(struct systime_sched *sched)
+{
+    int d;
+
+    if(sched->count == 0) return SYSTIME_SCHED_NONE;
+
+    d = systime_diff(sched->heap[0]->deadline, sched->now());
+    return d > 0 ? (unsigned)d : 0;
+}
+
+
+
+/*
+    run all due tasks, returns time until next task like systime_sched_next()
+
+    Due tasks are those due at time sampled at start, and at most as many tasks as were
+    scheduled at start are run, so task that reschedules itself with delay 0 runs again
+    on next call, not in loop. Lateness is measured when task is dispatched, time is
+    sampled again before every task after first one, so time spent by functions of
+    earlier tasks counts in late_max and overruns of later ones.
+    Task is rescheduled or removed before its function is called, so function can
+    cancel or add any task, itself too.
+*/
+unsigned systime_sched_run(struct systime_sched *sched)
+{
+    unsigned now = sched->now();
+    unsigned start = now;
+    unsigned budget = sched->count;
+    unsigned dispatched = 0;
+
+    while(budget-- > 0 && sched->count > 0)
+    {
+        struct systime_task *task = sched->heap[0];
+        unsigned late;
+
+        if(systime_before(now, task->deadline)) break;
+
+        // first task starts at now, later ones after functions of earlier ones returned
+        if(dispatched++) start = sched->now();
+        late = start - task->deadline;
+
+        if(late > task->late_max) task->late_max = late;
+
+        if(task->period)
+        {
+            // whole missed periods are skipped, divide is done only on overrun
+            if(late >= task->period)
+            {
+                unsigned missed = late / task->period;
+                task->overruns += missed;
+                task->deadline += missed * task->period;
+            }
+            task->deadline += task->period;
+            sift_down(sched, 0);
+        }
+        else heap_remove(sched, task);
+
+        if(task->fcn) task->fcn(task, task->arg);
+    }
+
+    return systime_sched_next(sched);
+}
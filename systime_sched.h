@@ -0,0 +1,104 @@
+// systime_sched.h
+
+/*
+    Cooperative run to completion scheduler on top of systime.
+
+    Periodic and one-shot tasks are kept in binary heap ordered by deadline, so
+    systime_sched_run() only looks at tasks that are due and runs them in deadline order,
+    instead of superloop testing systime_ms_expired() of every task. Deadlines are compared
+    by serial number arithmetic (RFC 1982), so they can be at most half of full unsigned
+    period in the future.
+
+    Periodic task is released every period after its first deadline, independent of
+    when it actually ran, so there is no drift. If task ran so late that whole periods
+    were missed they are skipped and counted in overruns, largest lateness is kept in
+    late_max, measured when task is dispatched, after functions of tasks run before it.
+    systime_sched_run() returns time until next task, use it to sleep.
+
+    Tasks and heap array are allocated by caller, there is no dynamic allocation.
+    Scheduler works in units of time function passed to systime_sched_init(), for example
+    systime_ms or systime_tick. Scheduler and its tasks must be used from one context only.
+
+    Example:
+    static struct systime_task *heap[8];
+    static struct systime_sched sched;
+    static struct systime_task blink;
+
+    systime_sched_init(&sched, systime_ms, heap, 8);
+    systime_task_init(&blink, led_toggle, 0);
+    systime_sched_add(&sched, &blink, 0, 500);
+    while(1) sleep_ms(systime_sched_run(&sched));
+*/
+
+
+#ifndef __SYSTIME_SCHED_H__
+#define __SYSTIME_SCHED_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif // _cplusplus
+
+struct systime_task;
+
+// task function, called from systime_sched_run() when task is due
+typedef void (*systime_task_fcn)(struct systime_task *task, void *arg);
+
+struct systime_task
+{
+    systime_task_fcn fcn;
+    void *arg;
+    unsigned deadline;
+    // 0 for one-shot task
+    unsigned period;
+    // position in heap plus 1, 0 if task is not scheduled
+    unsigned slot;
+    // number of whole periods that were missed
+    unsigned overruns;
+    // largest time from deadline to start of task function
+    unsigned late_max;
+};
+
+struct systime_sched
+{
+    unsigned (*now)(void);
+    struct systime_task **heap;
+    unsigned size;
+    // number of scheduled tasks
+    unsigned count;
+};
+
+
+// initialize scheduler, now is time function (systime_ms, systime_tick, ...), heap has size entries
+void systime_sched_init(struct systime_sched *sched, unsigned (*now)(void), struct systime_task **heap, unsigned size);
+
+// initialize task, overrun statistics are cleared
+void systime_task_init(struct systime_task *task, systime_task_fcn fcn, void *arg);
+
+/*
+    schedule task delay after now, then every period, period 0 for one-shot task.
+    Task is rescheduled if it is already scheduled. Returns 0 if heap is full.
+*/
+int systime_sched_add(struct systime_sched *sched, struct systime_task *task, unsigned delay, unsigned period);
+
+// remove task if it is scheduled
+void systime_sched_cancel(struct systime_sched *sched, struct systime_task *task);
+
+// returned by systime_sched_next() and systime_sched_run() if there is no scheduled task
+#define SYSTIME_SCHED_NONE (~0U)
+
+// returns time until next task, 0 if some task is due or SYSTIME_SCHED_NONE
+unsigned systime_sched_next(struct systime_sched *sched);
+
+// run all due tasks, returns time until next task like systime_sched_next()
+unsigned systime_sched_run(struct systime_sched *sched);
+
+// true if task is scheduled
+#define systime_task_scheduled(task) ((task)->slot != 0)
+
+
+
+#ifdef __cplusplus
+}
+#endif // _cplusplus
+
+#endif // __SYSTIME_SCHED_H__
@@ -1,10 +1,21 @@
 // systime_sec.c
 
 #include "systime_tick.h"
+#include "systime_sync.h"
+#include "systime_stats.h"
 
 // define this if you have integer divide instruction
+// systime_sec_skip() divides 64-bit ms by 1000 in any case, on cores without 64-bit divide
+// it is library call like __aeabi_uldivmod, but only once per skip after sleep
 //#define SYSTEM_TIME_HAVE_DIV_INST
 
+// define this if you don't have integer divide instruction but want constant time
+// conversion using reciprocal multiplication instead of while loops
+//#define SYSTEM_TIME_USE_RECIPROCAL
+
+// conversion selected above
+#include "systime_conv.h"
+
 
 /*
     systime is infrastructure for time measurement on small embedded systems.
@@ -26,42 +37,356 @@
     Note: If tick_multiplier is not 1 there will be some error in miliseconds, but we use
     Bresenham's Algorithm so average error will be 0.
     See https://www.romanblack.com/one_sec.htm
+
+    Note: systime_sec() is wall clock, systime_sec_set() steps it and systime_adjust() slews
+    it by moving boundary of current second 1 ms at a time. systime_sec_mono() is another
+    seconds counter converted from the same ms that is never stepped or slewed.
 */
 
 
 
+#if !defined(SYSTIME_POSIX)
+
+#if defined(SYSTIME_STATIC_CONFIG)
+
 unsigned systime_curr_sec;
-static unsigned last_ms;
+unsigned systime_static_last_ms;
+unsigned systime_static_slew_total;
+static unsigned sec64_state;
+static unsigned mono_last_ms;
+static unsigned mono_sec;
+static unsigned slew_next;
+static unsigned slew_stop;
+static unsigned slew_interval;
+static unsigned slew_done;
+
+// names used by code shared with runtime configuration, ctx is not used
+#define last_ms systime_static_last_ms
+#define curr_sec systime_curr_sec
+#define slew_total systime_static_slew_total
+#define sec_read() systime_sec()
+#define ms_read() systime_ms()
+#define extend64(state, fcn) systime_extend64(state, fcn)
+#define default_ctx 0
 
-// returns current value of seconds free running counter
-unsigned systime_sec(void)
-{
-#if defined(SYSTEM_TIME_HAVE_DIV_INST)
-    unsigned diff = (systime_ms() - last_ms) / 1000U;
-    systime_curr_sec += diff;
-    last_ms += diff * 1000;
 #else
-    while((systime_ms() - last_ms) >= 1000)
+
+// names used by code shared with static configuration
+#define last_ms (ctx->last_ms)
+#define curr_sec (ctx->curr_sec)
+#define sec64_state (ctx->sec64_state)
+#define mono_last_ms (ctx->mono_last_ms)
+#define mono_sec (ctx->mono_sec)
+#define slew_total (ctx->slew_total)
+#define slew_next (ctx->slew_next)
+#define slew_stop (ctx->slew_stop)
+#define slew_interval (ctx->slew_interval)
+#define slew_done (ctx->slew_done)
+#define sec_read() systime_sec_ctx(ctx)
+#define ms_read() systime_ms_ctx(ctx)
+#define extend64(state, fcn) systime_extend64_ctx(state, fcn##_ctx, ctx)
+#define default_ctx (&systime_ctx_default)
+
+#endif // SYSTIME_STATIC_CONFIG
+
+
+
+// advances seconds counter curr with boundary last to miliseconds count now and returns it
+static unsigned sec_convert(unsigned *last_p, unsigned *curr_p, unsigned now)
+{
+    return systime_conv_update(last_p, curr_p, now, 1000U, 50000U, 0, 1);
+}
+
+
+
+/*
+    apply part of wall clock slew that is due at ms count now.
+
+    Correction of slew_total ms is spread as 1 ms every slew_interval ms. slew_next is ms
+    count at which next 1 ms is due, it is advanced by slew_interval for every applied ms
+    like Bresenham's boundary in systime_ms.c, so there is no divide and while nothing is
+    due only one compare is done. Boundaries are claimed with compare-exchange of
+    slew_next, so every ms is applied once, then boundary of current second is moved by
+    them. Wall clock is made faster by moving boundary back, slower by moving it forward,
+    but never past now.
+*/
+static void slew_apply(struct systime_ctx *ctx, unsigned now)
+{
+    int total = (int)systime_sync_load(&slew_total);
+    unsigned left, next, boundary, room, k;
+
+    (void)ctx;
+    if(total == 0) return;
+
+    left = total < 0 ? 0U - (unsigned)total : (unsigned)total;
+    next = systime_sync_load(&slew_next);
+    do
     {
-        last_ms += 1000;
-        systime_curr_sec++;
+        if((int)(now - next) < 0) return;
+
+        room = ~0U;
+        if(total < 0)
+        {
+            int r = (int)(now - systime_sync_load(&last_ms));
+            if(r <= 0) return;
+            room = (unsigned)r;
+        }
+
+        // one step for every applied ms, slew_stop is boundary after the last one
+        boundary = next;
+        k = 0;
+        while(boundary != slew_stop && (int)(now - boundary) >= 0 && k < room)
+        {
+            boundary += slew_interval;
+            k++;
+        }
+        if(k == 0) return;
     }
-#endif  // SYSTEM_TIME_HAVE_DIV_INST
+    while(!systime_sync_cas(&slew_next, &next, boundary));
+
+    systime_sync_add(&last_ms, total > 0 ? 0U - k : k);
+
+    // whole correction applied, unless new slew was started meanwhile
+    if(systime_sync_add(&slew_done, k) + k == left) systime_sync_cas(&slew_total, (unsigned *)&total, 0);
+}
+
+
+
+// start slewing wall clock by delta_ms over period_sec seconds
+static void adjust(struct systime_ctx *ctx, int delta_ms, unsigned period_sec)
+{
+    unsigned left = delta_ms < 0 ? 0U - (unsigned)delta_ms : (unsigned)delta_ms;
+    unsigned period = period_sec * 1000U;
+    unsigned old = systime_sync_load(&slew_total);
+
+    (void)ctx;
+
+    // stop current slew before its parameters are changed
+    while(!systime_sync_cas(&slew_total, &old, 0));
+    if(left == 0) return;
+
+    // at most 1 ms correction for every ms
+    if(period < left) period = left;
+
+    // only divide of slew, made once here
+    slew_interval = period / left;
+    slew_next = ms_read() + slew_interval;
+    slew_stop = slew_next + left * slew_interval;
+    slew_done = 0;
+
+    // publish new slew, it is 0 since it was stopped above
+    old = 0;
+    systime_sync_cas(&slew_total, &old, (unsigned)delta_ms);
+}
+
 
-    return systime_curr_sec;
+
+// returns ms of wall clock correction that is not yet applied
+static int adjust_remaining(struct systime_ctx *ctx)
+{
+    int total = (int)systime_sync_load(&slew_total);
+    int left;
+
+    (void)ctx;
+    if(total == 0) return 0;
+
+    left = (int)(total < 0 ? 0U - (unsigned)total : (unsigned)total) - (int)systime_sync_load(&slew_done);
+    return total < 0 ? -left : left;
 }
 
+
+
+// returns monotonic seconds, they are never stepped or slewed
+static unsigned sec_mono(struct systime_ctx *ctx)
+{
+    (void)ctx;
+    return sec_convert(&mono_last_ms, &mono_sec, ms_read());
+}
+
+
+
+// returns current value of seconds free running counter extended to 64 bits.
+static unsigned long long sec64(struct systime_ctx *ctx)
+{
+    (void)ctx;
+    return extend64(&sec64_state, systime_sec);
+}
+
+
+
+// account for ms elapsed while systime_sec() was not called, returns number of seconds added
+// ms can be more than 32 bits, so it is 64 by 32 bit divide regardless of SYSTEM_TIME_HAVE_DIV_INST
+static unsigned long long sec_skip(struct systime_ctx *ctx, unsigned long long ms)
+{
+    unsigned long long q = ms / 1000U;
+    unsigned last = systime_sync_load(&last_ms);
+    unsigned sec;
+
+    (void)ctx;
+
+    // remainder is converted by next systime_sec()
+    while(!systime_sync_cas(&last_ms, &last, last + (unsigned)q * 1000U));
+    sec = systime_sync_add(&curr_sec, (unsigned)q) + (unsigned)q;
+    systime_extend64_skip(&sec64_state, sec, q);
+
+    // monotonic seconds are only converted, they follow on next systime_sec_mono()
+    last = systime_sync_load(&mono_last_ms);
+    while(!systime_sync_cas(&mono_last_ms, &last, last + (unsigned)q * 1000U));
+    systime_sync_add(&mono_sec, (unsigned)q);
+
+    return q;
+}
+
+
+
 // set current seconds
+static void sec_set(struct systime_ctx *ctx, unsigned current_time)
+{
+    unsigned now = sec_read();
+    unsigned old;
+
+    (void)ctx;
+
+    // adding difference modulo full unsigned steps both forward and backward
+    systime_sync_add(&curr_sec, current_time - now);
+
+    // stepping back over msb must not look like wrap to systime_sec64(), state is
+    // changed with compare-exchange like systime_extend64() does, so extension is not lost
+    old = systime_sync_load(&sec64_state);
+    while(!systime_sync_cas(&sec64_state, &old, (old & ~1U) | (current_time >> (8 * sizeof(unsigned) - 1))));
+}
+
+
+
+#if defined(SYSTIME_STATIC_CONFIG)
+
+// called from systime_sec_update() while slewing
+void systime_static_slew(unsigned now)
+{
+    slew_apply(0, now);
+}
+
+#else
+
+// returns current value of seconds free running counter
+unsigned systime_sec_ctx(struct systime_ctx *ctx)
+{
+    // sample time only once, conversion is done on difference
+    return systime_sec_update_ctx(ctx, systime_ms_ctx(ctx));
+}
+
+
+
+// advances seconds counter to miliseconds count now and returns it
+unsigned systime_sec_update_ctx(struct systime_ctx *ctx, unsigned now)
+{
+    systime_stat_inc(sec_calls);
+    slew_apply(ctx, now);
+    return sec_convert(&last_ms, &curr_sec, now);
+}
+
+
+
+unsigned systime_sec(void)
+{
+    return systime_sec_ctx(&systime_ctx_default);
+}
+
+
+
+unsigned systime_sec_update(unsigned now)
+{
+    return systime_sec_update_ctx(&systime_ctx_default, now);
+}
+
+#endif // SYSTIME_STATIC_CONFIG
+
+
+
+unsigned systime_sec_mono(void)
+{
+    return sec_mono(default_ctx);
+}
+
+
+
+unsigned long long systime_sec64(void)
+{
+    return sec64(default_ctx);
+}
+
+
+
+unsigned long long systime_sec_skip(unsigned long long ms)
+{
+    return sec_skip(default_ctx, ms);
+}
+
+
+
 void systime_sec_set(unsigned current_time)
 {
-    unsigned now = systime_sec();
+    sec_set(default_ctx, current_time);
+}
 
-    if(now > current_time)
-    {
-        systime_curr_sec -= (now - current_time);
-    }
-    else
-    {
-        systime_curr_sec += (current_time - now);
-    }
+
+
+void systime_adjust(int delta_ms, unsigned period_sec)
+{
+    adjust(default_ctx, delta_ms, period_sec);
 }
+
+
+
+int systime_adjust_remaining(void)
+{
+    return adjust_remaining(default_ctx);
+}
+
+
+
+#if !defined(SYSTIME_STATIC_CONFIG)
+
+unsigned systime_sec_mono_ctx(struct systime_ctx *ctx)
+{
+    return sec_mono(ctx);
+}
+
+
+
+unsigned long long systime_sec64_ctx(struct systime_ctx *ctx)
+{
+    return sec64(ctx);
+}
+
+
+
+unsigned long long systime_sec_skip_ctx(struct systime_ctx *ctx, unsigned long long ms)
+{
+    return sec_skip(ctx, ms);
+}
+
+
+
+void systime_sec_set_ctx(struct systime_ctx *ctx, unsigned current_time)
+{
+    sec_set(ctx, current_time);
+}
+
+
+
+void systime_adjust_ctx(struct systime_ctx *ctx, int delta_ms, unsigned period_sec)
+{
+    adjust(ctx, delta_ms, period_sec);
+}
+
+
+
+int systime_adjust_remaining_ctx(struct systime_ctx *ctx)
+{
+    return adjust_remaining(ctx);
+}
+
+#endif // SYSTIME_STATIC_CONFIG
+
+#endif // SYSTIME_POSIX
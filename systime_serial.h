@@ -0,0 +1,107 @@
+// systime_serial.h
+
+/*
+    Serial number arithmetic (RFC 1982) for systime counters.
+
+    All systime counters wrap with full unsigned period, so two times can't be compared
+    with < directly. a is before b if (int)(a - b) < 0, which is correct as long as
+    times are less than half of unsigned period apart. At exactly half period apart
+    comparison is undefined by RFC 1982, here each time is taken as before the other.
+
+    systime_before(), systime_after(), systime_min_deadline() and systime_diff() work on
+    plain unsigned times of any unit. For every unit there is also typed version on
+    one member struct, systime_tick_t, systime_us_t, systime_ms_t and systime_sec_t,
+    so compiler rejects comparing ms deadline with tick deadline. Structs are passed by
+    value and compile to the same code as plain unsigned.
+
+    Example:
+    systime_ms_t a = systime_ms_of(systime_ms() + 100);
+    systime_ms_t b = systime_ms_add(a, 50);
+    if(systime_ms_before(a, b)) ...
+*/
+
+
+#ifndef __SYSTIME_SERIAL_H__
+#define __SYSTIME_SERIAL_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif // _cplusplus
+
+
+// true if time a is before time b
+static inline int systime_before(unsigned a, unsigned b)
+{
+    return (int)(a - b) < 0;
+}
+
+// true if time a is after time b
+static inline int systime_after(unsigned a, unsigned b)
+{
+    return (int)(b - a) < 0;
+}
+
+// returns earlier of deadlines a and b
+static inline unsigned systime_min_deadline(unsigned a, unsigned b)
+{
+    return systime_before(b, a) ? b : a;
+}
+
+// returns signed distance from time b to time a, positive if a is after b
+static inline int systime_diff(unsigned a, unsigned b)
+{
+    return (int)(a - b);
+}
+
+
+
+// defines type systime_<unit>_t and its serial arithmetic functions
+#define SYSTIME_SERIAL_TYPE(unit) \
+    typedef struct { unsigned raw; } systime_##unit##_t; \
+ \
+    /* typed time from raw counter value */ \
+    static inline systime_##unit##_t systime_##unit##_of(unsigned raw) \
+    { \
+        systime_##unit##_t t; \
+        t.raw = raw; \
+        return t; \
+    } \
+ \
+    /* time interval units after t */ \
+    static inline systime_##unit##_t systime_##unit##_add(systime_##unit##_t t, unsigned interval) \
+    { \
+        return systime_##unit##_of(t.raw + interval); \
+    } \
+ \
+    static inline int systime_##unit##_before(systime_##unit##_t a, systime_##unit##_t b) \
+    { \
+        return systime_before(a.raw, b.raw); \
+    } \
+ \
+    static inline int systime_##unit##_after(systime_##unit##_t a, systime_##unit##_t b) \
+    { \
+        return systime_after(a.raw, b.raw); \
+    } \
+ \
+    static inline systime_##unit##_t systime_##unit##_min_deadline(systime_##unit##_t a, systime_##unit##_t b) \
+    { \
+        return systime_##unit##_before(b, a) ? b : a; \
+    } \
+ \
+    static inline int systime_##unit##_diff(systime_##unit##_t a, systime_##unit##_t b) \
+    { \
+        return systime_diff(a.raw, b.raw); \
+    }
+
+SYSTIME_SERIAL_TYPE(tick)
+SYSTIME_SERIAL_TYPE(us)
+SYSTIME_SERIAL_TYPE(ms)
+SYSTIME_SERIAL_TYPE(sec)
+
+
+
+#ifdef __cplusplus
+}
+#endif // _cplusplus
+
+#endif // __SYSTIME_SERIAL_H__
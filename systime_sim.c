@@ -0,0 +1,71 @@
+// systime_sim.c
+
+#include "systime_sim.h"
+
+#if defined(SYSTIME_HAVE_CTX)
+
+unsigned long systime_sim_reads;
+
+// total simulated timer ticks
+static unsigned long long sim_time;
+static unsigned long long sim_mask;
+static unsigned sim_mult;
+static unsigned sim_ticks1ms;
+
+
+
+// initialize simulated timer and systime with it
+void systime_sim_init(unsigned hw_bits, unsigned tick_multiplier, unsigned ticks_for_1ms)
+{
+    sim_mask = (1ULL << hw_bits) - 1;
+    sim_mult = tick_multiplier;
+    sim_ticks1ms = ticks_for_1ms;
+
+    systime_tick_init(systime_sim_read, hw_bits, tick_multiplier);
+    systime_time_init(ticks_for_1ms);
+
+    systime_sim_reads = 0;
+}
+
+
+
+// move simulated time by timer_ticks timer ticks
+void systime_sim_advance(unsigned long long timer_ticks)
+{
+    sim_time += timer_ticks;
+}
+
+
+
+// returns simulated timer state, this is function given to systime_tick_init()
+unsigned systime_sim_read(void)
+{
+    systime_sim_reads++;
+    return (unsigned)(sim_time & sim_mask);
+}
+
+
+
+// exact internal ticks since start
+unsigned long long systime_sim_ref_ticks(void)
+{
+    return sim_time * sim_mult;
+}
+
+
+
+// exact ms since start
+unsigned long long systime_sim_ref_ms(void)
+{
+    return systime_sim_ref_ticks() / sim_ticks1ms;
+}
+
+
+
+// exact seconds since start
+unsigned long long systime_sim_ref_sec(void)
+{
+    return systime_sim_ref_ms() / 1000U;
+}
+
+#endif // SYSTIME_HAVE_CTX
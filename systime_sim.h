@@ -0,0 +1,58 @@
+// systime_sim.h
+
+/*
+    Simulated timer source for host builds.
+
+    systime_sim_init() plugs simulated timer into systime_tick_init() and systime_time_init()
+    with given hw_bits, tick_multiplier and ticks_for_1ms. Test or benchmark program then
+    moves simulated time with systime_sim_advance() and compares systime counters with
+    exact reference values computed from total simulated time.
+
+    Simulated time starts at 0, and systime_sim_init() must be called before any other
+    systime function, so systime counters also start at 0 and reference values are exact.
+
+    Example: check that ms never drift after random gaps
+    systime_sim_init(16, 10, 110592);
+    for(;;)
+    {
+        systime_sim_advance(rand() % 65536);
+        assert(systime_ms() == (unsigned)systime_sim_ref_ms());
+    }
+
+    Not available with SYSTIME_STATIC_CONFIG or SYSTIME_POSIX.
+*/
+
+
+#ifndef __SYSTIME_SIM_H__
+#define __SYSTIME_SIM_H__
+
+#include "systime_tick.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif // _cplusplus
+
+// number of simulated timer reads, to measure timer register traffic
+extern unsigned long systime_sim_reads;
+
+// initialize simulated timer and systime with it
+void systime_sim_init(unsigned hw_bits, unsigned tick_multiplier, unsigned ticks_for_1ms);
+
+// move simulated time by timer_ticks timer ticks
+void systime_sim_advance(unsigned long long timer_ticks);
+
+// returns simulated timer state, this is function given to systime_tick_init()
+unsigned systime_sim_read(void);
+
+// exact internal ticks, ms and seconds since start
+unsigned long long systime_sim_ref_ticks(void);
+unsigned long long systime_sim_ref_ms(void);
+unsigned long long systime_sim_ref_sec(void);
+
+
+
+#ifdef __cplusplus
+}
+#endif // _cplusplus
+
+#endif // __SYSTIME_SIM_H__
@@ -0,0 +1,40 @@
+// systime_sleep.c
+
+#include "systime_tick.h"
+
+
+/*
+    Tickless sleep support.
+
+    Timer can wrap many times during sleep and systime then can not see how much time
+    elapsed. Caller measures sleep with other time source and systime_sleep_resync()
+    advances ticks, us, ms and seconds counters by that amount without catch-up loops.
+*/
+
+
+
+// fold sleep of any length into ticks, ms and seconds counters in O(1)
+void systime_sleep_resync(unsigned long long elapsed)
+{
+    unsigned long long ticks = systime_tick_skip(elapsed);
+
+#if defined(SYSTIME_HAVE_US)
+    systime_us_skip(ticks);
+#endif // SYSTIME_HAVE_US
+    systime_sec_skip(systime_ms_skip(ticks));
+}
+
+
+
+#if defined(SYSTIME_HAVE_CTX)
+
+// the same for time base ctx
+void systime_sleep_resync_ctx(struct systime_ctx *ctx, unsigned long long elapsed)
+{
+    unsigned long long ticks = systime_tick_skip_ctx(ctx, elapsed);
+
+    systime_us_skip_ctx(ctx, ticks);
+    systime_sec_skip_ctx(ctx, systime_ms_skip_ctx(ctx, ticks));
+}
+
+#endif // SYSTIME_HAVE_CTX
@@ -0,0 +1,177 @@
+// systime_static.h
+
+/*
+    Compile time specialized systime.
+
+    Instead of systime_tick_init() and systime_time_init() timer read function and all
+    parameters are given as compile time constants, so systime_tick(), systime_ms() and
+    systime_sec() are static inline functions without function pointer calls and with
+    mask, multiply and ms/sec conversions folded by the compiler.
+
+    To use it define SYSTIME_STATIC_CONFIG as name of configuration header, for example
+    -DSYSTIME_STATIC_CONFIG='"board_systime.h"', for every file including systime_tick.h
+    and for systime_tick.c, systime_ms.c and systime_sec.c. This header is then included
+    from systime_tick.h and must not be included directly.
+
+    Configuration header must define:
+
+    SYSTIME_STATIC_READ()       expression that returns current timer state
+    SYSTIME_STATIC_HW_BITS      number of bits in timer state
+    SYSTIME_STATIC_TICKS_1MS    number of internal ticks for 1 milisecond
+
+    and can define:
+
+    SYSTIME_STATIC_TICK_MULT    number of internal ticks for every timer tick, default 1
+    SYSTIME_STATIC_TICKS_1MS_DEN  denominator of SYSTIME_STATIC_TICKS_1MS for fractional
+                                rate, default 1, for example 110592 / 10 for 11.0592MHz
+    SYSTIME_STATIC_TICKS_1US    number of internal ticks for 1 microsecond, for systime_us()
+    SYSTIME_STATIC_TICKS_1US_DEN  its denominator, default 1, for example 6912 / 625
+    SYSTEM_TIME_HAVE_DIV_INST   if you have integer divide instruction
+    SYSTEM_TIME_USE_RECIPROCAL  for constant time conversion without divide instruction
+
+    Example: timer clock is 10MHz, timer register is 32 bits and unsigned is 32 bits
+    #define SYSTIME_STATIC_READ()       (TIM2->CNT)
+    #define SYSTIME_STATIC_HW_BITS      32
+    #define SYSTIME_STATIC_TICKS_1MS    10000
+
+    systime_tick_init() and systime_time_init() don't exist in this configuration,
+    call systime_sec() once at startup to synchronize counters to timer.
+*/
+
+
+#ifndef __SYSTIME_STATIC_H__
+#define __SYSTIME_STATIC_H__
+
+#if !defined(SYSTIME_STATIC_READ) || !defined(SYSTIME_STATIC_HW_BITS) || !defined(SYSTIME_STATIC_TICKS_1MS)
+#error "SYSTIME_STATIC_READ, SYSTIME_STATIC_HW_BITS and SYSTIME_STATIC_TICKS_1MS must be defined"
+#endif
+
+#if !defined(SYSTIME_STATIC_TICK_MULT)
+#define SYSTIME_STATIC_TICK_MULT 1
+#endif
+
+#if !defined(SYSTIME_STATIC_TICKS_1MS_DEN)
+#define SYSTIME_STATIC_TICKS_1MS_DEN 1
+#endif
+
+#if defined(SYSTIME_STATIC_TICKS_1US) && !defined(SYSTIME_STATIC_TICKS_1US_DEN)
+#define SYSTIME_STATIC_TICKS_1US_DEN 1
+#endif
+
+#include "systime_sync.h"
+#include "systime_stats.h"
+#include "systime_conv.h"
+
+#define SYSTIME_STATIC_MASK (~0U >> (8 * sizeof(unsigned) - (SYSTIME_STATIC_HW_BITS)))
+
+// private state, defined in systime_tick.c, systime_ms.c and systime_sec.c
+// systime_static_last_hw is accumulated timer ticks, low bits are the same as timer
+extern unsigned systime_static_last_hw;
+// 64-bit extension of ticks and ms, kept current by every read
+extern unsigned systime_static_tick64_state;
+extern unsigned systime_static_ms64_state;
+// ticks multiplied by SYSTIME_STATIC_TICKS_1MS_DEN where last whole ms ends
+extern unsigned systime_static_last_ticks;
+extern unsigned systime_static_last_ms;
+// nonzero while wall clock is slewed, see systime_adjust()
+extern unsigned systime_static_slew_total;
+void systime_static_slew(unsigned now);
+#if defined(SYSTIME_STATIC_TICKS_1US)
+extern unsigned systime_static_last_us_ticks;
+#endif // SYSTIME_STATIC_TICKS_1US
+
+
+
+// returns current system time internal tick count
+// it have period of full unsigned int
+static inline unsigned systime_tick(void)
+{
+    unsigned ext = systime_sync_load(&systime_static_tick64_state);
+    unsigned old, acc, gap;
+
+    // if timer state is wide as unsigned there is nothing to accumulate
+    if(SYSTIME_STATIC_HW_BITS == 8 * sizeof(unsigned) && SYSTIME_STATIC_TICK_MULT == 1)
+    {
+        acc = SYSTIME_STATIC_READ();
+        systime_stat_inc(tick_reads);
+        systime_curr_ticks = acc;
+        systime_sync_extend64(&systime_static_tick64_state, ext, acc);
+        return acc;
+    }
+
+    old = systime_sync_load(&systime_static_last_hw);
+    do
+    {
+        gap = (SYSTIME_STATIC_READ() - old) & SYSTIME_STATIC_MASK;
+        acc = old + gap;
+        systime_stat_inc(tick_reads);
+    }
+    while(!systime_sync_cas(&systime_static_last_hw, &old, acc));
+
+    systime_stat_gap(gap, SYSTIME_STATIC_HW_BITS);
+
+    systime_curr_ticks = acc * SYSTIME_STATIC_TICK_MULT;
+    systime_sync_extend64(&systime_static_tick64_state, ext, systime_curr_ticks);
+    return acc * SYSTIME_STATIC_TICK_MULT;
+}
+
+
+// advances miliseconds counter to tick count now and returns it
+static inline unsigned systime_ms_update(unsigned now)
+{
+    unsigned ext = systime_sync_load(&systime_static_ms64_state);
+    unsigned ms;
+
+    systime_stat_inc(ms_calls);
+    ms = systime_conv_update(&systime_static_last_ticks, &systime_curr_ms, now * SYSTIME_STATIC_TICKS_1MS_DEN,
+        SYSTIME_STATIC_TICKS_1MS, 50U * (SYSTIME_STATIC_TICKS_1MS), ~0U / (SYSTIME_STATIC_TICKS_1MS), 0);
+
+    // ms only move here, so epoch of systime_ms64() is kept current
+    systime_sync_extend64(&systime_static_ms64_state, ext, ms);
+    return ms;
+}
+
+
+// returns current value of miliseconds free running counter
+static inline unsigned systime_ms(void)
+{
+    return systime_ms_update(systime_tick());
+}
+
+
+#if defined(SYSTIME_STATIC_TICKS_1US)
+
+// advances microseconds counter to tick count now and returns it
+static inline unsigned systime_us_update(unsigned now)
+{
+    systime_stat_inc(us_calls);
+    return systime_conv_update(&systime_static_last_us_ticks, &systime_curr_us, now * SYSTIME_STATIC_TICKS_1US_DEN,
+        SYSTIME_STATIC_TICKS_1US, 50U * (SYSTIME_STATIC_TICKS_1US), ~0U / (SYSTIME_STATIC_TICKS_1US), 0);
+}
+
+
+// returns current value of microseconds free running counter
+static inline unsigned systime_us(void)
+{
+    return systime_us_update(systime_tick());
+}
+
+#endif // SYSTIME_STATIC_TICKS_1US
+
+
+// advances seconds counter to miliseconds count now and returns it
+static inline unsigned systime_sec_update(unsigned now)
+{
+    systime_stat_inc(sec_calls);
+    if(systime_sync_load(&systime_static_slew_total)) systime_static_slew(now);
+    return systime_conv_update(&systime_static_last_ms, &systime_curr_sec, now, 1000U, 50000U, 0, 1);
+}
+
+
+// returns current value of seconds free running counter
+static inline unsigned systime_sec(void)
+{
+    return systime_sec_update(systime_ms());
+}
+
+#endif // __SYSTIME_STATIC_H__
@@ -0,0 +1,26 @@
+// systime_stats.c
+
+#include "systime_stats.h"
+
+#if defined(SYSTIME_STATS)
+
+struct systime_stats systime_stats;
+
+
+
+// clear all counters
+void systime_stats_reset(void)
+{
+    struct systime_stats empty = { 0 };
+    systime_stats = empty;
+}
+
+
+
+// returns largest timer advance between two reads in 1/1000 of timer period
+unsigned systime_stats_gap_permille(void)
+{
+    return (unsigned)(((unsigned long long)systime_stats.max_gap * 1000U) >> (8 * sizeof(unsigned)));
+}
+
+#endif // SYSTIME_STATS
@@ -0,0 +1,78 @@
+// systime_stats.h
+
+/*
+    Instrumentation of systime itself.
+
+    If SYSTIME_STATS is defined for all systime files, systime counts timer reads and calls
+    of systime_ms(), systime_us() and systime_sec(), iterations of conversion loops, and
+    records largest advance of timer between two consecutive reads. When that advance gets
+    close to full timer period systime is about to lose time, so call it more often or use
+    systime_tick_overflow_init().
+
+    Largest advance is kept as fraction of timer period, 2^32 is full period, so it is
+    comparable between time bases with different timer width. It is measured only when
+    timer is accumulated, timer as wide as unsigned or counted by overflow interrupt
+    never loses time.
+
+    Counters are shared by all time bases and are updated without synchronization,
+    so with concurrent callers some counts can be lost.
+    Without SYSTIME_STATS all macros are empty.
+*/
+
+
+#ifndef __SYSTIME_STATS_H__
+#define __SYSTIME_STATS_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif // _cplusplus
+
+struct systime_stats
+{
+    // timer reads, including those made by systime_ms(), systime_us() and systime_sec()
+    unsigned tick_reads;
+    unsigned ms_calls;
+    unsigned us_calls;
+    unsigned sec_calls;
+    // iterations of ticks to ms and us conversion loops
+    unsigned conv_loops;
+    // iterations of ms to seconds conversion loops
+    unsigned sec_loops;
+    // largest timer advance between two reads, fraction of timer period
+    unsigned max_gap;
+};
+
+
+#if defined(SYSTIME_STATS)
+
+extern struct systime_stats systime_stats;
+
+// clear all counters
+void systime_stats_reset(void);
+
+// returns largest timer advance between two reads in 1/1000 of timer period
+unsigned systime_stats_gap_permille(void);
+
+#define systime_stat_inc(field) (systime_stats.field++)
+// timer advanced gap ticks of timer with hw_bits
+#define systime_stat_gap(gap, hw_bits) do { \
+        unsigned systime_stat_g = (gap) << (8 * sizeof(unsigned) - (hw_bits)); \
+        if(systime_stat_g > systime_stats.max_gap) systime_stats.max_gap = systime_stat_g; \
+    } while(0)
+
+#else
+
+#define systime_stats_reset() ((void)0)
+#define systime_stats_gap_permille() 0
+#define systime_stat_inc(field) ((void)0)
+#define systime_stat_gap(gap, hw_bits) ((void)0)
+
+#endif // SYSTIME_STATS
+
+
+
+#ifdef __cplusplus
+}
+#endif // _cplusplus
+
+#endif // __SYSTIME_STATS_H__
@@ -0,0 +1,179 @@
+// systime_sync.h
+
+/*
+    Concurrency mode of systime.
+
+    All systime state is kept in single words that are updated only with compare-exchange,
+    and counters are only incremented, so concurrent callers (main loop and ISR, two RTOS
+    tasks) never double count or lose timer period and never see time going backwards.
+    With concurrency mode interval between two calls to systime_ms() or systime_sec() must
+    be less than half of full unsigned period of ticks or ms.
+
+    How compare-exchange is done is selected at compile time, the same for all systime files:
+
+    SYSTIME_USE_ATOMICS
+        lock-free compare-exchange with __atomic builtins of GCC and Clang (C11 memory model).
+        Use it on cores with exclusive access instructions (LDREX/STREX on Cortex-M3 and up,
+        RISC-V A extension, x86). Interrupts are never disabled.
+
+    SYSTIME_CRITICAL_ENTER() and SYSTIME_CRITICAL_EXIT()
+        compare-exchange is done in this critical section. It is only few instructions
+        long and timer is never read inside it. Use it on cores without atomics (Cortex-M0).
+        ENTER can declare local variable used by EXIT, for example
+        #define SYSTIME_CRITICAL_ENTER() unsigned systime_irq = irq_save()
+        #define SYSTIME_CRITICAL_EXIT()  irq_restore(systime_irq)
+
+    If nothing is defined systime must be used from one context only, and interval between
+    two calls can be up to full unsigned period.
+*/
+
+
+#ifndef __SYSTIME_SYNC_H__
+#define __SYSTIME_SYNC_H__
+
+// true if other context already advanced state last past sample now
+#if defined(SYSTIME_USE_ATOMICS) || defined(SYSTIME_CRITICAL_ENTER)
+#define systime_sync_stale(now, last) ((int)((now) - (last)) < 0)
+#else
+#define systime_sync_stale(now, last) 0
+#endif // SYSTIME_USE_ATOMICS
+
+#if defined(SYSTIME_USE_ATOMICS)
+
+static inline unsigned systime_sync_load(unsigned *p)
+{
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+// if *p is *expected store desired and return 1, else load *p to *expected and return 0
+static inline int systime_sync_cas(unsigned *p, unsigned *expected, unsigned desired)
+{
+    return __atomic_compare_exchange_n(p, expected, desired, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+// add v to *p and return old value
+static inline unsigned systime_sync_add(unsigned *p, unsigned v)
+{
+    return __atomic_fetch_add(p, v, __ATOMIC_ACQ_REL);
+}
+
+// plain stores before it are visible before any store after it, use it before publishing data
+static inline void systime_sync_release(void)
+{
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+// plain loads after it see data published before word loaded before it
+static inline void systime_sync_acquire(void)
+{
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+}
+
+// store word that has only one writer, stores before it are visible before it
+static inline void systime_sync_store_release(unsigned *p, unsigned v)
+{
+    __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+
+#else
+
+#if !defined(SYSTIME_CRITICAL_ENTER)
+#define SYSTIME_CRITICAL_ENTER()
+#define SYSTIME_CRITICAL_EXIT()
+#endif // SYSTIME_CRITICAL_ENTER
+
+static inline unsigned systime_sync_load(unsigned *p)
+{
+    return *(volatile unsigned *)p;
+}
+
+// if *p is *expected store desired and return 1, else load *p to *expected and return 0
+static inline int systime_sync_cas(unsigned *p, unsigned *expected, unsigned desired)
+{
+    volatile unsigned *v = p;
+    int ok;
+
+    SYSTIME_CRITICAL_ENTER();
+    ok = (*v == *expected);
+    if(ok) *v = desired;
+    else *expected = *v;
+    SYSTIME_CRITICAL_EXIT();
+
+    return ok;
+}
+
+// add v to *p and return old value
+static inline unsigned systime_sync_add(unsigned *p, unsigned v)
+{
+    volatile unsigned *vp = p;
+    unsigned old;
+
+    SYSTIME_CRITICAL_ENTER();
+    old = *vp;
+    *vp = old + v;
+    SYSTIME_CRITICAL_EXIT();
+
+    return old;
+}
+
+/*
+    without atomics callers share one core, where only compiler can reorder plain
+    accesses around volatile ones, so compiler barrier is enough
+*/
+#if !defined(SYSTIME_COMPILER_BARRIER)
+#if defined(__GNUC__)
+#define SYSTIME_COMPILER_BARRIER() __asm__ volatile("" ::: "memory")
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L && !defined(__STDC_NO_ATOMICS__)
+#include <stdatomic.h>
+#define SYSTIME_COMPILER_BARRIER() atomic_signal_fence(memory_order_seq_cst)
+#else
+#error "define SYSTIME_COMPILER_BARRIER() as compiler memory barrier"
+#endif // __GNUC__
+#endif // SYSTIME_COMPILER_BARRIER
+
+// plain stores before it are visible before any store after it, use it before publishing data
+static inline void systime_sync_release(void)
+{
+    SYSTIME_COMPILER_BARRIER();
+}
+
+// plain loads after it see data published before word loaded before it
+static inline void systime_sync_acquire(void)
+{
+    SYSTIME_COMPILER_BARRIER();
+}
+
+// store word that has only one writer, stores before it are visible before it
+static inline void systime_sync_store_release(unsigned *p, unsigned v)
+{
+    // single word store can not be torn, no critical section is needed
+    SYSTIME_COMPILER_BARRIER();
+    *(volatile unsigned *)p = v;
+}
+
+#endif // SYSTIME_USE_ATOMICS
+
+
+/*
+    extend counter value lo to 64 bits with state of one word, old is state loaded
+    before lo was read, so lo is never older than state.
+
+    state keeps high word shifted left by one and most significant bit of last seen
+    low word, so it fits in one word and can not be torn. Low word wrapped if its msb
+    changed from 1 to 0 since last call, so counter must not advance by half of its
+    full period or more between two calls.
+*/
+static inline unsigned long long systime_sync_extend64(unsigned *state, unsigned old, unsigned lo)
+{
+    unsigned hi = old >> 1;
+    unsigned msb = lo >> (8 * sizeof(unsigned) - 1);
+
+    if((old & 1) && !msb) hi++;
+
+    // if this fails other caller already stored newer state
+    if(((hi << 1) | msb) != old) systime_sync_cas(state, &old, (hi << 1) | msb);
+
+    return ((unsigned long long)hi << (8 * sizeof(unsigned))) | lo;
+}
+
+#endif // __SYSTIME_SYNC_H__
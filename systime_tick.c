@@ -1,6 +1,8 @@
 // systime_tick.c
 
 #include "systime_tick.h"
+#include "systime_sync.h"
+#include "systime_stats.h"
 
 
 /*
@@ -26,28 +28,172 @@
 */
 
 
-static unsigned systime_tick_internal(void);
+#if !defined(SYSTIME_POSIX)
 
-static unsigned (*systickshw)(void);
-static unsigned (*systime_tick_current)(void) = &systime_tick_internal;
+#if defined(SYSTIME_STATIC_CONFIG)
 
-static unsigned last_timer_ticks;
 unsigned systime_curr_ticks;
-static unsigned mask;
-static unsigned tickmult;
+unsigned systime_static_last_hw;
+unsigned systime_static_tick64_state;
 
+// names used by code shared with runtime configuration, ctx is not used
+#define timer_ticks systime_static_last_hw
+#define tick64_state systime_static_tick64_state
+#define curr_ticks systime_curr_ticks
+#define systickshw() SYSTIME_STATIC_READ()
+#define tick_read() systime_tick()
+#define mask SYSTIME_STATIC_MASK
+#define tickmult SYSTIME_STATIC_TICK_MULT
+#define hwbits SYSTIME_STATIC_HW_BITS
+#define tick_direct (SYSTIME_STATIC_HW_BITS == 8 * sizeof(unsigned) && SYSTIME_STATIC_TICK_MULT == 1)
+#define tick_overflow 0
+#define extend64(state, fcn) systime_extend64(state, fcn)
+#define default_ctx 0
+
+#else
+
+static unsigned tick_read_internal(struct systime_ctx *ctx);
+static unsigned tick_read_direct(struct systime_ctx *ctx);
+static unsigned tick_read_overflow(struct systime_ctx *ctx);
+static unsigned long long overflow_read(struct systime_ctx *ctx);
+
+// context used by functions without _ctx suffix
+// rates are set so systime_ms() works before systime_time_init(), we are dividing by div
+struct systime_ctx systime_ctx_default =
+{
+    .tick = &tick_read_internal,
+    .ms = { .div = 10000, .den = 1, .recip = ~0U / 10000, .div50 = 50 * 10000 },
+    .us = { .div = 10, .den = 1, .recip = ~0U / 10, .div50 = 50 * 10 },
+};
+
+// names used by code shared with static configuration
+#define timer_ticks (ctx->timer_ticks)
+#define curr_ticks (ctx->curr_ticks)
+#define systickshw() (ctx->read())
+#define tick_read() (ctx->tick(ctx))
+#define mask (ctx->mask)
+#define tickmult (ctx->tickmult)
+#define hwbits (ctx->hwbits)
+#define tick64_state (ctx->tick64_state)
+#define overflow_pending (ctx->overflow_pending)
+#define overflow_periods (ctx->overflow_periods)
+// timer is read directly, there is no accumulated state
+#define tick_direct (ctx->tick == &tick_read_direct)
+// timer periods are counted by overflow interrupt
+#define tick_overflow (ctx->tick == &tick_read_overflow)
+#define extend64(state, fcn) systime_extend64_ctx(state, fcn##_ctx, ctx)
+#define default_ctx (&systime_ctx_default)
 
 
 
 // returns current system time internal tick count.
 // it has period of full unsigned int.
+unsigned systime_tick_ctx(struct systime_ctx *ctx)
+{
+    return tick_read();
+}
+
+
+
 unsigned systime_tick(void)
 {
-    return systime_tick_current();
+    return systime_ctx_default.tick(&systime_ctx_default);
+}
+
+#endif // SYSTIME_STATIC_CONFIG
+
+
+
+// returns current system time internal tick count extended to 64 bits.
+// every tick read keeps extension current, see systime_tick64() in systime_tick.h.
+static unsigned long long tick64(struct systime_ctx *ctx)
+{
+    (void)ctx;
+
+#if defined(SYSTIME_HAVE_CTX)
+    // overflow interrupt counts all timer periods, nothing to extend
+    if(tick_overflow) return overflow_read(ctx);
+#endif // SYSTIME_HAVE_CTX
+
+    return extend64(&tick64_state, systime_tick);
+}
+
+
+
+/*
+    account for timer ticks elapsed while systime was not called, for example during sleep
+    longer than timer full period.
+
+    elapsed is number of timer ticks since last systime call, measured by caller with some
+    other time source (RTC, wakeup timer). It has to be correct only to half of timer
+    period, exact count inside period is taken from timer itself.
+    Returns number of internal ticks that systime_tick() advanced.
+*/
+static unsigned long long tick_skip(struct systime_ctx *ctx, unsigned long long elapsed)
+{
+    unsigned long long total;
+    unsigned old, seen;
+
+    (void)ctx;
+
+    // overflow interrupt already counted every period
+    if(tick_overflow) return 0;
+
+    if(tick_direct)
+    {
+        // raw read, tick_read() would move extension before skip is added to it
+        unsigned now = systickshw();
+
+        // part inside period since last read, every ms and us conversion reads timer too
+        seen = now - curr_ticks;
+        total = seen;
+
+        // whole 2^32 periods that timer itself can not show, rounded to nearest
+        if(elapsed > seen)
+            total += ((elapsed - seen + (1ULL << (8 * sizeof(unsigned) - 1))) >> (8 * sizeof(unsigned))) << (8 * sizeof(unsigned));
+
+        curr_ticks = now;
+        systime_extend64_skip(&tick64_state, now, total);
+        return total;
+    }
+
+    old = systime_sync_load(&timer_ticks);
+    do
+    {
+        seen = (systickshw() - old) & mask;
+        total = seen;
+
+        // whole timer periods that timer itself can not show, rounded to nearest
+        if(elapsed > seen)
+            total += ((elapsed - seen + (mask >> 1) + 1) >> hwbits) << hwbits;
+    }
+    while(!systime_sync_cas(&timer_ticks, &old, old + (unsigned)total));
+
+    curr_ticks = (old + (unsigned)total) * tickmult;
+    total *= tickmult;
+    systime_extend64_skip(&tick64_state, curr_ticks, total);
+
+    return total;
+}
+
+
+
+unsigned long long systime_tick64(void)
+{
+    return tick64(default_ctx);
 }
 
 
 
+unsigned long long systime_tick_skip(unsigned long long elapsed)
+{
+    return tick_skip(default_ctx, elapsed);
+}
+
+
+
+#if !defined(SYSTIME_STATIC_CONFIG)
+
 //##############################################################################################
 
 /*
@@ -72,31 +218,207 @@ unsigned systime_tick(void)
     Bresenham's Algorithm so average error will be 0.
     See https://www.romanblack.com/one_sec.htm
 */
-void systime_tick_init(unsigned (*fcn)(void), unsigned hw_bits, unsigned tick_multiplier)
+void systime_tick_init_ctx(struct systime_ctx *ctx, unsigned (*fcn)(void), unsigned hw_bits, unsigned tick_multiplier)
 {
-    // if timer state is wide as unsigned we can directly call systickshw() instead of systime_tick()
+    // if timer state is wide as unsigned we can directly call systickshw() instead of accumulating
     if(hw_bits == 8 * sizeof(unsigned) && tick_multiplier == 1)
     {
-        systime_tick_current = fcn;
+        ctx->tick = &tick_read_direct;
+        ctx->read = fcn;
+        hwbits = hw_bits;
     }
     else
     {
-        systime_tick_current = &systime_tick_internal;
+        ctx->tick = &tick_read_internal;
         tickmult = tick_multiplier;
-        systickshw = fcn;
+        ctx->read = fcn;
         mask = (1UL << hw_bits) - 1;
+        hwbits = hw_bits;
     }
     
-    systime_tick();
+    tick_read();
 }
 
 
 
-static unsigned systime_tick_internal(void)
+void systime_tick_init(unsigned (*fcn)(void), unsigned hw_bits, unsigned tick_multiplier)
 {
+    systime_tick_init_ctx(&systime_ctx_default, fcn, hw_bits, tick_multiplier);
+}
+
+
+
+static unsigned tick_read_internal(struct systime_ctx *ctx)
+{
+    unsigned ext = systime_sync_load(&tick64_state);
+    unsigned old = systime_sync_load(&timer_ticks);
+    unsigned acc, gap;
+
+    // timer is read again after failed compare-exchange so it is never older than state
+    do
+    {
+        gap = (systickshw() - old) & mask;
+        acc = old + gap;
+        systime_stat_inc(tick_reads);
+    }
+    while(!systime_sync_cas(&timer_ticks, &old, acc));
+
+    systime_stat_gap(gap, hwbits);
+
+    // every read advances at most one timer period, so epoch of systime_tick64() is kept here
+    curr_ticks = acc * tickmult;
+    systime_sync_extend64(&tick64_state, ext, curr_ticks);
+    return acc * tickmult;
+}
+
+
+
+static unsigned tick_read_direct(struct systime_ctx *ctx)
+{
+    unsigned ext = systime_sync_load(&tick64_state);
     unsigned now = systickshw();
-    unsigned diff = (now - last_timer_ticks) & mask;
-    systime_curr_ticks += diff * tickmult;
-    last_timer_ticks = now;
-    return systime_curr_ticks;
+
+    systime_stat_inc(tick_reads);
+    curr_ticks = now;
+    systime_sync_extend64(&tick64_state, ext, now);
+    return now;
+}
+
+
+
+/*
+    use timer overflow interrupt to count timer periods, so systime doesn't have to be called
+    at least once in timer full period and time is never lost. Call it right after
+    systime_tick_init() and enable timer overflow interrupt that calls systime_tick_overflow_isr().
+
+    pending is pointer to function that returns nonzero if timer overflowed but interrupt
+    is not yet serviced (interrupt pending flag). It is used when systime is called with
+    interrupts disabled or from interrupt of same or higher priority.
+*/
+void systime_tick_overflow_init_ctx(struct systime_ctx *ctx, unsigned (*pending)(void))
+{
+    overflow_pending = pending;
+    ctx->tick = &tick_read_overflow;
+    tick_read();
+}
+
+
+
+void systime_tick_overflow_init(unsigned (*pending)(void))
+{
+    systime_tick_overflow_init_ctx(&systime_ctx_default, pending);
+}
+
+
+
+// call from timer overflow interrupt after clearing its flag
+void systime_tick_overflow_isr_ctx(struct systime_ctx *ctx)
+{
+    systime_sync_add(&overflow_periods, 1);
+}
+
+
+
+void systime_tick_overflow_isr(void)
+{
+    systime_tick_overflow_isr_ctx(&systime_ctx_default);
+}
+
+
+
+// returns internal ticks of all counted timer periods, 64-bit so it never wraps
+static unsigned long long overflow_read(struct systime_ctx *ctx)
+{
+    unsigned periods, now;
+    unsigned long long acc;
+
+    // repeat if overflow interrupt was serviced between reads
+    do
+    {
+        periods = systime_sync_load(&overflow_periods);
+        now = systickshw();
+        systime_stat_inc(tick_reads);
+
+        // timer wrapped but interrupt is not serviced yet, read again so now is after wrap
+        if(overflow_pending && overflow_pending())
+        {
+            now = systickshw();
+            acc = ((unsigned long long)periods + 1) << hwbits;
+        }
+        else
+        {
+            acc = (unsigned long long)periods << hwbits;
+        }
+    }
+    while(periods != systime_sync_load(&overflow_periods));
+
+    return (acc + now) * tickmult;
+}
+
+
+
+static unsigned tick_read_overflow(struct systime_ctx *ctx)
+{
+    curr_ticks = (unsigned)overflow_read(ctx);
+    return curr_ticks;
+}
+
+
+
+unsigned long long systime_tick64_ctx(struct systime_ctx *ctx)
+{
+    return tick64(ctx);
+}
+
+
+
+unsigned long long systime_tick_skip_ctx(struct systime_ctx *ctx, unsigned long long elapsed)
+{
+    return tick_skip(ctx, elapsed);
+}
+
+#endif // SYSTIME_STATIC_CONFIG
+
+#endif // SYSTIME_POSIX
+
+
+
+unsigned long long systime_extend64(unsigned *state, unsigned (*read)(void))
+{
+    unsigned old = systime_sync_load(state);
+    return systime_sync_extend64(state, old, read());
+}
+
+
+
+#if defined(SYSTIME_HAVE_CTX)
+
+// extend counter of context, read is called with ctx
+unsigned long long systime_extend64_ctx(unsigned *state, unsigned (*read)(struct systime_ctx *ctx), struct systime_ctx *ctx)
+{
+    unsigned old = systime_sync_load(state);
+    return systime_sync_extend64(state, old, read(ctx));
+}
+
+#endif // SYSTIME_HAVE_CTX
+
+
+
+// advance 64-bit extension state by delta, lo is counter value after it was advanced
+void systime_extend64_skip(unsigned *state, unsigned lo, unsigned long long delta)
+{
+    unsigned prev = lo - (unsigned)delta;
+    unsigned old = systime_sync_load(state);
+    unsigned hi;
+    unsigned long long value;
+
+    do
+    {
+        hi = old >> 1;
+        if((old & 1) && !(prev >> (8 * sizeof(unsigned) - 1))) hi++;
+
+        value = (((unsigned long long)hi << (8 * sizeof(unsigned))) | prev) + delta;
+        hi = (unsigned)(value >> (8 * sizeof(unsigned)));
+    }
+    while(!systime_sync_cas(state, &old, (hi << 1) | (lo >> (8 * sizeof(unsigned) - 1))));
 }
@@ -16,6 +16,8 @@
 
     Note: it is important to call some of systime time functions (systime_tick(), systime_ms(),
     systime_sec()) at least once in timer full period. Otherwise, systime will lose some time.
+    After sleep longer than that use systime_sleep_resync(), or count timer periods in
+    overflow interrupt with systime_tick_overflow_init().
 
     Note: If tick_multiplier is not 1 there will be some error in miliseconds, but we use
     Bresenham's Algorithm so average error will be 0.
@@ -31,12 +33,138 @@
 extern "C" {
 #endif // _cplusplus
 
+struct systime_ctx;
+
+// compile time specialized configuration, see systime_static.h
+#if defined(SYSTIME_STATIC_CONFIG)
+#include SYSTIME_STATIC_CONFIG
+#endif // SYSTIME_STATIC_CONFIG
+
+#if defined(SYSTIME_STATIC_CONFIG) && defined(SYSTIME_POSIX)
+#error "SYSTIME_STATIC_CONFIG and SYSTIME_POSIX can't be used together"
+#endif
+
+// systime_us() exists in runtime configuration and in static one with SYSTIME_STATIC_TICKS_1US
+#if !defined(SYSTIME_STATIC_CONFIG) || defined(SYSTIME_STATIC_TICKS_1US)
+#define SYSTIME_HAVE_US
+#endif
+
+// time base contexts (_ctx functions) exist only in runtime configuration, see systime_posix.c
+#if !defined(SYSTIME_STATIC_CONFIG) && !defined(SYSTIME_POSIX)
+#define SYSTIME_HAVE_CTX
+#endif
+
+#if defined(SYSTIME_HAVE_CTX)
+
+// conversion of ticks to counter of ms or us
+struct systime_rate
+{
+    // ticks multiplied by den where last whole unit ends
+    unsigned last;
+    // ticks for one unit multiplied by den, it must not be 0
+    unsigned div;
+    unsigned den;
+    // floor((2^32 - 1) / div) or 50 * div, depends on build options
+    unsigned recip;
+    unsigned div50;
+    unsigned curr;
+};
+
+/*
+    state of one time base (clock domain).
+
+    Functions with _ctx suffix work on given context, so several time bases, for example
+    fast high resolution timer and low power RTC clocked timer, can run side by side.
+    Functions without suffix work on systime_ctx_default.
+
+    Context must be zero initialized (static or cleared) and then initialized with
+    systime_tick_init_ctx() and systime_time_init_ctx() before other use.
+    Fields are private, read counters only with systime functions.
+*/
+struct systime_ctx
+{
+    // used on every systime_tick_ctx(), kept together at start of struct
+    unsigned (*tick)(struct systime_ctx *ctx);
+    unsigned (*read)(void);
+    // accumulated timer ticks, low hw_bits are always the same as timer state
+    unsigned timer_ticks;
+    unsigned mask;
+    unsigned tickmult;
+    unsigned curr_ticks;
+
+    // miliseconds, microseconds and seconds
+    struct systime_rate ms;
+    struct systime_rate us;
+    unsigned last_ms;
+    unsigned curr_sec;
+    unsigned mono_last_ms;
+    unsigned mono_sec;
+
+    // rarely used
+    unsigned hwbits;
+    unsigned (*overflow_pending)(void);
+    unsigned overflow_periods;
+    unsigned tick64_state;
+    unsigned ms64_state;
+    unsigned sec64_state;
+    // wall clock slew, see systime_adjust()
+    unsigned slew_total;
+    unsigned slew_next;
+    unsigned slew_stop;
+    unsigned slew_interval;
+    unsigned slew_done;
+};
+
+extern struct systime_ctx systime_ctx_default;
+
+// counters of default time base
+#define systime_curr_ticks (systime_ctx_default.curr_ticks)
+#define systime_curr_ms (systime_ctx_default.ms.curr)
+#define systime_curr_us (systime_ctx_default.us.curr)
+#define systime_curr_sec (systime_ctx_default.curr_sec)
+
+#elif defined(SYSTIME_STATIC_CONFIG)
+
 extern unsigned systime_curr_ticks;
 extern unsigned systime_curr_ms;
 extern unsigned systime_curr_sec;
+#if defined(SYSTIME_HAVE_US)
+extern unsigned systime_curr_us;
+#endif // SYSTIME_HAVE_US
+
+#endif // SYSTIME_HAVE_CTX
+
+
+// static inline systime functions of compile time configuration
+#if defined(SYSTIME_STATIC_CONFIG)
+#include "systime_static.h"
+#endif // SYSTIME_STATIC_CONFIG
+
+
+/*
+    internal ticks for 1 ms of default time base are systime_ticks_1ms_num() /
+    systime_ticks_1ms_den(), rate set by systime_time_init_frac() and changed by
+    systime_calib_ref(). Modules that convert time to ticks with it read it only when they
+    are initialized (systime_delay_init(), systime_poll_start_ms(), systime_bucket_init()),
+    initialize them again after rate is changed.
+*/
+#if defined(SYSTIME_STATIC_CONFIG)
+#define systime_ticks_1ms_num() (SYSTIME_STATIC_TICKS_1MS)
+#define systime_ticks_1ms_den() (SYSTIME_STATIC_TICKS_1MS_DEN)
+#elif defined(SYSTIME_POSIX)
+// 1 ns ticks
+#define systime_ticks_1ms_num() 1000000U
+#define systime_ticks_1ms_den() 1U
+#else
+#define systime_ticks_1ms_num() (systime_ctx_default.ms.div)
+#define systime_ticks_1ms_den() (systime_ctx_default.ms.den)
+#endif // SYSTIME_STATIC_CONFIG
 
 
 
+// init functions exist in POSIX configuration too, there they do nothing
+#if defined(SYSTIME_HAVE_CTX) || defined(SYSTIME_POSIX)
+
 /*
     initialize systime tick
 
@@ -60,12 +188,57 @@ extern unsigned systime_curr_sec;
     See https://www.romanblack.com/one_sec.htm
 */
 void systime_tick_init(unsigned (*fcn)(void), unsigned hw_bits, unsigned tick_multiplier);
+#endif // SYSTIME_HAVE_CTX || SYSTIME_POSIX
 
 
+#if !defined(SYSTIME_STATIC_CONFIG)
 // returns current system time internal tick count
 // it have period of full unsigned int
 unsigned systime_tick(void);
+#endif // SYSTIME_STATIC_CONFIG
+
+
+#if defined(SYSTIME_HAVE_CTX)
+
+/*
+    use timer overflow interrupt to count timer periods, so systime doesn't have to be called
+    at least once in timer full period and time is never lost. Call it right after
+    systime_tick_init() and call systime_tick_overflow_isr() from timer overflow interrupt
+    after clearing its flag.
+
+    pending is pointer to function that returns nonzero if timer overflowed but interrupt
+    is not yet serviced (interrupt pending flag).
+
+    Example: 16-bit timer at 1MHz without keep-alive task
+    systime_tick_init(timer_read, 16, 1);
+    systime_tick_overflow_init(timer_overflow_flag);
+*/
+void systime_tick_overflow_init(unsigned (*pending)(void));
+
+// call from timer overflow interrupt after clearing its flag
+void systime_tick_overflow_isr(void);
+
+#endif // SYSTIME_HAVE_CTX
+
+
+/*
+    returns current system time internal tick count extended to 64 bits.
+
+    High word is epoch that every tick read updates (systime_tick(), systime_ms(),
+    systime_us(), systime_sec() and others), so systime_tick64() itself can be called
+    rarely. Epoch is kept in one word with msb of last seen ticks, see
+    systime_sync_extend64(), so ticks must not advance by half of unsigned period between
+    two systime reads: with accumulated timer (hw_bits less than unsigned, timer period
+    times tick_multiplier at most half of unsigned period) that holds whenever systime is
+    called once in timer full period as it must be. With 32-bit timer read directly
+    some systime read is needed at least once in half of timer period (about 214 s at
+    10MHz). With overflow interrupt (systime_tick_overflow_init()) value is made from
+    counted periods and is exact however rarely it is called.
+*/
+unsigned long long systime_tick64(void);
+
 
+#if defined(SYSTIME_HAVE_CTX) || defined(SYSTIME_POSIX)
 
 /*
     initialize systime time
@@ -89,23 +262,206 @@ unsigned systime_tick(void);
 */
 void systime_time_init(unsigned ticks_for_1ms);
 
+/*
+    initialize systime time with fractional rate, num / den internal ticks for 1 milisecond.
+    Fraction of ms is carried from one ms to next, so tick_multiplier can stay 1.
+    Interval between two calls to systime_ms() must be less than full unsigned period / den.
+    Calling it again with the same den changes rate without losing phase of current ms.
+
+    Example: timer clock is 11.0592MHz, timer register is 16 bits and unsigned is 32 bits
+    systime_tick_init(timer_read, 16, 1):
+    systime_time_init_frac(110592, 10);
+*/
+void systime_time_init_frac(unsigned num, unsigned den);
+
+// initialize systime time with internal tick rate in Hz, it is reduced to fraction for 1 ms
+void systime_time_init_hz(unsigned ticks_hz);
+
+#endif // SYSTIME_HAVE_CTX || SYSTIME_POSIX
+
+
+#if !defined(SYSTIME_STATIC_CONFIG)
+
 
 // returns current value of miliseconds free running counter
 unsigned systime_ms(void);
 
+// advances miliseconds counter to tick count now ( result of systime_tick() ) and returns it
+unsigned systime_ms_update(unsigned now);
+
+/*
+    returns current value of microseconds free running counter.
 
+    It is converted from ticks like systime_ms(), with rate set by systime_time_init().
+    Interval between two calls must be less than full unsigned period of ticks divided by
+    reduced denominator of ticks for 1 us, for example 625 for 11.0592MHz (6912 / 625),
+    1 for 1MHz or 10MHz timer and 1000 for 1kHz timer.
+*/
+unsigned systime_us(void);
+
+// advances microseconds counter to tick count now ( result of systime_tick() ) and returns it
+unsigned systime_us_update(unsigned now);
+
+#endif // SYSTIME_STATIC_CONFIG
+
+
+// returns current value of miliseconds free running counter extended to 64 bits.
+// every ms update (systime_ms(), systime_sec() and others) keeps its epoch current
+unsigned long long systime_ms64(void);
+
+
+#if !defined(SYSTIME_STATIC_CONFIG)
 // returns current value of seconds free running counter
 unsigned systime_sec(void);
 
-// set current seconds
+// advances seconds counter to miliseconds count now ( result of systime_ms() ) and returns it
+unsigned systime_sec_update(unsigned now);
+#endif // SYSTIME_STATIC_CONFIG
+
+// returns current value of seconds free running counter extended to 64 bits.
+// it must be called at least once in half of seconds period (68 years)
+unsigned long long systime_sec64(void);
+
+// set current seconds, it steps wall clock systime_sec() but not systime_sec_mono()
 void systime_sec_set(unsigned current_time);
 
+// returns monotonic seconds, converted from ms like systime_sec() but never stepped or slewed
+unsigned systime_sec_mono(void);
+
+/*
+    slew wall clock systime_sec() by delta_ms over period_sec seconds instead of step,
+    like adjtime(). Positive delta_ms makes wall clock go faster until it gains delta_ms.
+    Boundary of current second is moved 1 ms at a time, at most 1 ms for every ms, so
+    systime_sec() never goes backward. New call replaces slew in progress, delta_ms 0
+    stops it. Call it from one context, systime_sec() can be read from any.
+*/
+void systime_adjust(int delta_ms, unsigned period_sec);
+
+// returns ms of slew that is not yet applied
+int systime_adjust_remaining(void);
+
+
+/*
+    account for time elapsed while systime was not called, for example during sleep
+    longer than timer full period. Returned values are number of added ticks, us, ms and
+    seconds. Remainders are converted by next systime_us(), systime_ms() and systime_sec().
+
+    systime_tick_skip() elapsed is number of timer ticks since last systime call, measured
+    by caller with some other time source. It has to be correct only to half of timer
+    period, exact count inside period is taken from timer itself. With overflow interrupt
+    (systime_tick_overflow_init()) periods are already counted and it returns 0.
+*/
+unsigned long long systime_tick_skip(unsigned long long elapsed);
+unsigned long long systime_ms_skip(unsigned long long ticks);
+unsigned long long systime_sec_skip(unsigned long long ms);
+#if defined(SYSTIME_HAVE_US)
+unsigned long long systime_us_skip(unsigned long long ticks);
+#endif // SYSTIME_HAVE_US
+
+/*
+    fold sleep of any length into ticks, us, ms and seconds counters in O(1).
+
+    timer must keep counting during sleep, elapsed is number of timer ticks since last systime
+    call as measured by caller (see systime_tick_skip()). Call it after wake-up before
+    anything else uses systime.
+*/
+void systime_sleep_resync(unsigned long long elapsed);
+
+
+// all three counters from one timer read
+struct systime_snapshot
+{
+    unsigned ticks;
+    unsigned ms;
+    unsigned sec;
+};
+
+// reads timer only once and coherently updates and returns ticks, ms and seconds
+void systime_now(struct systime_snapshot *now);
+
+/*
+    coarse reads return ms and seconds published by last update without reading timer.
+    Call systime_coarse_update() from periodic interrupt or scheduler, or any other systime
+    function updates them too. They lag real time by at most one update interval.
+*/
+unsigned systime_ms_coarse(void);
+unsigned systime_sec_coarse(void);
+void systime_coarse_update(void);
+
+/*
+    extend free running unsigned counter returned by read to 64 bits.
+
+    state is one word initialized to 0 and it must be unique for every extended counter.
+    Function must be called at least once in half of counter full period.
+    High word has one bit less than unsigned.
+*/
+unsigned long long systime_extend64(unsigned *state, unsigned (*read)(void));
+
+// advance 64-bit extension state by delta, lo is counter value after it was advanced
+void systime_extend64_skip(unsigned *state, unsigned lo, unsigned long long delta);
+
+#if defined(SYSTIME_HAVE_CTX)
+
+// the same functions for time base ctx, see struct systime_ctx
+void systime_tick_init_ctx(struct systime_ctx *ctx, unsigned (*fcn)(void), unsigned hw_bits, unsigned tick_multiplier);
+void systime_tick_overflow_init_ctx(struct systime_ctx *ctx, unsigned (*pending)(void));
+void systime_tick_overflow_isr_ctx(struct systime_ctx *ctx);
+void systime_time_init_ctx(struct systime_ctx *ctx, unsigned ticks_for_1ms);
+void systime_time_init_frac_ctx(struct systime_ctx *ctx, unsigned num, unsigned den);
+void systime_time_init_hz_ctx(struct systime_ctx *ctx, unsigned ticks_hz);
+// change only ms rate to num / den ticks for 1 ms, us rate is kept, see systime_calib.h
+void systime_time_ms_rate_ctx(struct systime_ctx *ctx, unsigned num, unsigned den);
+
+unsigned systime_tick_ctx(struct systime_ctx *ctx);
+unsigned systime_ms_ctx(struct systime_ctx *ctx);
+unsigned systime_ms_update_ctx(struct systime_ctx *ctx, unsigned now);
+unsigned systime_us_ctx(struct systime_ctx *ctx);
+unsigned systime_us_update_ctx(struct systime_ctx *ctx, unsigned now);
+unsigned systime_sec_ctx(struct systime_ctx *ctx);
+unsigned systime_sec_update_ctx(struct systime_ctx *ctx, unsigned now);
+void systime_sec_set_ctx(struct systime_ctx *ctx, unsigned current_time);
+unsigned systime_sec_mono_ctx(struct systime_ctx *ctx);
+void systime_adjust_ctx(struct systime_ctx *ctx, int delta_ms, unsigned period_sec);
+int systime_adjust_remaining_ctx(struct systime_ctx *ctx);
+
+unsigned long long systime_tick64_ctx(struct systime_ctx *ctx);
+unsigned long long systime_ms64_ctx(struct systime_ctx *ctx);
+unsigned long long systime_sec64_ctx(struct systime_ctx *ctx);
+
+unsigned long long systime_tick_skip_ctx(struct systime_ctx *ctx, unsigned long long elapsed);
+unsigned long long systime_ms_skip_ctx(struct systime_ctx *ctx, unsigned long long ticks);
+unsigned long long systime_sec_skip_ctx(struct systime_ctx *ctx, unsigned long long ms);
+unsigned long long systime_us_skip_ctx(struct systime_ctx *ctx, unsigned long long ticks);
+void systime_sleep_resync_ctx(struct systime_ctx *ctx, unsigned long long elapsed);
+void systime_now_ctx(struct systime_ctx *ctx, struct systime_snapshot *now);
+unsigned systime_ms_coarse_ctx(struct systime_ctx *ctx);
+unsigned systime_sec_coarse_ctx(struct systime_ctx *ctx);
+void systime_coarse_update_ctx(struct systime_ctx *ctx);
+
+// extend counter of context to 64 bits, read is called with ctx
+unsigned long long systime_extend64_ctx(unsigned *state, unsigned (*read)(struct systime_ctx *ctx), struct systime_ctx *ctx);
+
+#endif // SYSTIME_HAVE_CTX
+
+
 // number of elapsed ticks since start
 #define systime_tick_elapsed(start) (systime_tick() - (start))
 
 // true if elapsed >= interval ticks since start
 #define systime_tick_expired(start, interval) ( (systime_tick() - (start) ) >= (interval) )
 
+// number of elapsed us since start
+#define systime_us_elapsed(start) (systime_us() - (start))
+
+// true if elapsed >= interval us since start
+#define systime_us_expired(start, interval) ( (systime_us() - (start) ) >= (interval) )
+
+// number of elapsed coarse ms since start, it doesn't read timer
+#define systime_ms_coarse_elapsed(start) (systime_ms_coarse() - (start))
+
+// true if elapsed >= interval coarse ms since start, it doesn't read timer
+#define systime_ms_coarse_expired(start, interval) ( (systime_ms_coarse() - (start) ) >= (interval) )
+
 // number of elapsed ms since start
 #define systime_ms_elapsed(start) (systime_ms() - (start))
 
@@ -118,6 +474,12 @@ void systime_sec_set(unsigned current_time);
 // true if elapsed >= interval seconds since start
 #define systime_sec_expired(start, interval) ( (systime_sec() - (start) ) >= (interval) )
 
+// number of elapsed monotonic seconds since start, for intervals over wall clock changes
+#define systime_sec_mono_elapsed(start) (systime_sec_mono() - (start))
+
+// true if elapsed >= interval monotonic seconds since start
+#define systime_sec_mono_expired(start, interval) ( (systime_sec_mono() - (start) ) >= (interval) )
+
 
 
 #ifdef __cplusplus
@@ -0,0 +1,308 @@
+// systime_timer.c
+
+#include "systime_timer.h"
+#include "systime_serial.h"
+
+
+#define SLOT_MASK (SYSTIME_TIMER_SLOTS - 1)
+
+
+
+static void slot_insert(struct systime_timer **head, struct systime_timer *timer)
+{
+    timer->next = *head;
+    if(timer->next) timer->next->pprev = &timer->next;
+    timer->pprev = head;
+    *head = timer;
+}
+
+
+
+static void slot_remove(struct systime_timer *timer)
+{
+    *timer->pprev = timer->next;
+    if(timer->next) timer->next->pprev = timer->pprev;
+    timer->next = 0;
+    timer->pprev = 0;
+}
+
+
+
+// move list from head to work so slot can be refilled while list is processed
+static void slot_take(struct systime_timer **head, struct systime_timer **work)
+{
+    *work = *head;
+    *head = 0;
+    if(*work) (*work)->pprev = work;
+}
+
+
+
+// put timer in slot by its distance from wheel time
+static void wheel_insert(struct systime_timer_wheel *wheel, struct systime_timer *timer)
+{
+    unsigned idx = timer->expires - wheel->time;
+    unsigned level;
+
+    // already expired, slot of its time was processed, it will be run by next poll
+    if(systime_before(timer->expires, wheel->time))
+    {
+        slot_insert(&wheel->due, timer);
+        return;
+    }
+
+    for(level = 0; level < SYSTIME_TIMER_LEVELS - 1; level++)
+    {
+        if(idx < (1U << ((level + 1) * SYSTIME_TIMER_SLOT_BITS))) break;
+    }
+
+    slot_insert(&wheel->slot[level][(timer->expires >> (level * SYSTIME_TIMER_SLOT_BITS)) & SLOT_MASK], timer);
+}
+
+
+
+// move timers from slot of level to lower levels, returns slot index
+static unsigned wheel_cascade(struct systime_timer_wheel *wheel, unsigned level)
+{
+    unsigned index = (wheel->time >> (level * SYSTIME_TIMER_SLOT_BITS)) & SLOT_MASK;
+    struct systime_timer *work;
+
+    slot_take(&wheel->slot[level][index], &work);
+    while(work)
+    {
+        struct systime_timer *timer = work;
+        slot_remove(timer);
+        wheel_insert(wheel, timer);
+    }
+
+    return index;
+}
+
+
+
+/*
+    returns distance from wheel time to first time at which poll has slot to run or
+    cascade, or max if it is not closer.
+
+    Slot of level 0 is run when wheel time reaches it, slot of higher level is cascaded
+    when all lower bits of wheel time are 0, so for every level slots are checked in order
+    from first such time and first nonempty one is candidate.
+*/
+static unsigned wheel_distance(struct systime_timer_wheel *wheel, unsigned max)
+{
+    unsigned level, min = max;
+
+    for(level = 0; level < SYSTIME_TIMER_LEVELS; level++)
+    {
+        unsigned shift = level * SYSTIME_TIMER_SLOT_BITS;
+        // top level can have less than SLOT_BITS bits of time
+        unsigned mask = 32 - shift < SYSTIME_TIMER_SLOT_BITS ? (1U << (32 - shift)) - 1 : SLOT_MASK;
+        unsigned first = (0U - wheel->time) & ((1U << shift) - 1);
+        unsigned index = ((wheel->time + first) >> shift) & mask;
+        unsigned i;
+
+        for(i = 0; i <= mask; i++)
+        {
+            unsigned d = first + (i << shift);
+            if(d >= min) break;
+            if(wheel->slot[level][(index + i) & mask])
+            {
+                min = d;
+                break;
+            }
+        }
+    }
+
+    return min;
+}
+
+
+
+// remove timers of work list from slot_take() and run their functions
+static void wheel_run(struct systime_timer_wheel *wheel, struct systime_timer **work)
+{
+    while(*work)
+    {
+        struct systime_timer *timer = *work;
+        slot_remove(timer);
+        wheel->count--;
+        if(timer->fcn) timer->fcn(timer, timer->arg);
+    }
+}
+
+
+
+// distance from now of earliest timer in slot, or SYSTIME_TIMER_NONE
+static unsigned slot_earliest(unsigned now, struct systime_timer *timer)
+{
+    unsigned min = SYSTIME_TIMER_NONE;
+
+    for(; timer; timer = timer->next)
+    {
+        unsigned idx = timer->expires - now;
+        if(systime_before(timer->expires, now)) return 0;
+        if(idx < min) min = idx;
+    }
+
+    return min;
+}
+
+
+
+//##############################################################################################
+
+
+// initialize wheel, now is time function (systime_ms, systime_tick, ...)
+void systime_timer_wheel_init(struct systime_timer_wheel *wheel, unsigned (*now)(void))
+{
+    unsigned level, index;
+
+    for(level = 0; level < SYSTIME_TIMER_LEVELS; level++)
+    {
+        for(index = 0; index < SYSTIME_TIMER_SLOTS; index++) wheel->slot[level][index] = 0;
+    }
+
+    wheel->now = now;
+    wheel->count = 0;
+    wheel->due = 0;
+    wheel->time = now();
+}
+
+
+
+// initialize timer, fcn can be 0 if only systime_timer_pending() is used as flag
+void systime_timer_init(struct systime_timer *timer, systime_timer_fcn fcn, void *arg)
+{
+    timer->next = 0;
+    timer->pprev = 0;
+    timer->expires = 0;
+    timer->fcn = fcn;
+    timer->arg = arg;
+}
+
+
+
+// start timer that expires at absolute time expires, timer is restarted if pending
+void systime_timer_add(struct systime_timer_wheel *wheel, struct systime_timer *timer, unsigned expires)
+{
+    if(systime_timer_pending(timer)) slot_remove(timer);
+    else wheel->count++;
+
+    timer->expires = expires;
+    wheel_insert(wheel, timer);
+}
+
+
+
+// start timer that expires interval after now
+void systime_timer_start(struct systime_timer_wheel *wheel, struct systime_timer *timer, unsigned interval)
+{
+    systime_timer_add(wheel, timer, wheel->now() + interval);
+}
+
+
+
+// stop timer if it is pending
+void systime_timer_cancel(struct systime_timer_wheel *wheel, struct systime_timer *timer)
+{
+    if(!systime_timer_pending(timer)) return;
+
+    slot_remove(timer);
+    wheel->count--;
+}
+
+
+
+// run functions of all expired timers
+void systime_timer_poll(struct systime_timer_wheel *wheel)
+{
+    unsigned now = wheel->now();
+    struct systime_timer *work;
+
+    slot_take(&wheel->due, &work);
+    wheel_run(wheel, &work);
+
+    while(!systime_before(now, wheel->time))
+    {
+        unsigned index;
+
+        // nothing to cascade or run, skip to now
+        if(wheel->count == 0)
+        {
+            wheel->time = now + 1;
+            break;
+        }
+
+        // jump over empty slots to first slot to run or cascade, or past now
+        wheel->time += wheel_distance(wheel, now - wheel->time + 1);
+        if(systime_before(now, wheel->time)) break;
+
+        // when lower level wraps, next slot of higher level is moved down
+        index = wheel->time & SLOT_MASK;
+        if(index == 0)
+        {
+            unsigned level;
+            for(level = 1; level < SYSTIME_TIMER_LEVELS; level++)
+            {
+                if(wheel_cascade(wheel, level) != 0) break;
+            }
+        }
+
+        wheel->time++;
+
+        // timer functions can add timers, they go to slots of new wheel time
+        slot_take(&wheel->slot[0][index], &work);
+        wheel_run(wheel, &work);
+
+        // expired timers added by them are run at next processed time of this poll
+        if(!systime_before(now, wheel->time))
+        {
+            slot_take(&wheel->due, &work);
+            wheel_run(wheel, &work);
+        }
+    }
+}
+
+
+
+/*
+    returns time until first pending timer expires, 0 if some timer is already due
+    or SYSTIME_TIMER_NONE if there are no pending timers.
+
+    Slots of one level hold timers in time order starting from slot after current one.
+    Current slot holds either timers waiting to be cascaded or timers one full level
+    period ahead, so it is always checked too. Earliest timer is minimum over levels.
+    Timers added already expired wait in due list and make it 0, next poll runs them.
+*/
+unsigned systime_timer_next(struct systime_timer_wheel *wheel)
+{
+    unsigned min = SYSTIME_TIMER_NONE;
+    unsigned level, now;
+
+    if(wheel->count == 0) return SYSTIME_TIMER_NONE;
+    if(wheel->due) return 0;
+
+    now = wheel->now();
+
+    for(level = 0; level < SYSTIME_TIMER_LEVELS; level++)
+    {
+        unsigned index = (wheel->time >> (level * SYSTIME_TIMER_SLOT_BITS)) & SLOT_MASK;
+        unsigned i, d;
+
+        d = slot_earliest(now, wheel->slot[level][index]);
+        if(d < min) min = d;
+
+        for(i = 1; i < SYSTIME_TIMER_SLOTS; i++)
+        {
+            struct systime_timer *timer = wheel->slot[level][(index + i) & SLOT_MASK];
+            if(timer)
+            {
+                d = slot_earliest(now, timer);
+                if(d < min) min = d;
+                break;
+            }
+        }
+    }
+
+    return min;
+}
@@ -0,0 +1,113 @@
+// systime_timer.h
+
+/*
+    Hierarchical timer wheel on top of systime.
+
+    Instead of polling many systime_ms_expired() checks, timers are kept in wheel of
+    SYSTIME_TIMER_LEVELS levels with SYSTIME_TIMER_SLOTS slots each. Timer is put in slot
+    by its expiry time, and every poll touches only slots that are due. Timers of higher
+    levels are moved to lower levels (cascaded) when their slot becomes due.
+
+    Wheel works in units of time function passed to systime_timer_wheel_init(), for example
+    systime_ms or systime_tick. Expiry times are compared by serial number arithmetic
+    (RFC 1982), so timer can be at most half of full unsigned period in the future.
+
+    Timers and wheel are allocated by caller, insert and cancel are O(1). Poll jumps over
+    empty slots, so its cost does not grow with time elapsed since last poll. Wheel and its
+    timers must be used from one context only.
+
+    Example:
+    static struct systime_timer_wheel wheel;
+    static struct systime_timer led_timer;
+
+    systime_timer_wheel_init(&wheel, systime_ms);
+    systime_timer_init(&led_timer, led_toggle, 0);
+    systime_timer_start(&wheel, &led_timer, 500);
+    while(1) systime_timer_poll(&wheel);
+*/
+
+
+#ifndef __SYSTIME_TIMER_H__
+#define __SYSTIME_TIMER_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif // _cplusplus
+
+// number of time bits for every level of wheel
+#if !defined(SYSTIME_TIMER_SLOT_BITS)
+#define SYSTIME_TIMER_SLOT_BITS 4
+#endif // SYSTIME_TIMER_SLOT_BITS
+
+#define SYSTIME_TIMER_SLOTS (1U << SYSTIME_TIMER_SLOT_BITS)
+
+// enough levels to cover 32 bits of time
+#define SYSTIME_TIMER_LEVELS ((32 + SYSTIME_TIMER_SLOT_BITS - 1) / SYSTIME_TIMER_SLOT_BITS)
+
+
+struct systime_timer;
+
+// timer function, called from systime_timer_poll() when timer expires
+typedef void (*systime_timer_fcn)(struct systime_timer *timer, void *arg);
+
+struct systime_timer
+{
+    struct systime_timer *next;
+    // pointer to pointer that points to this timer, 0 if timer is not pending
+    struct systime_timer **pprev;
+    unsigned expires;
+    systime_timer_fcn fcn;
+    void *arg;
+};
+
+struct systime_timer_wheel
+{
+    unsigned (*now)(void);
+    // next time to be processed, all timers that expire before it are already done
+    unsigned time;
+    // number of pending timers
+    unsigned count;
+    // timers added already expired, run by next poll
+    struct systime_timer *due;
+    struct systime_timer *slot[SYSTIME_TIMER_LEVELS][SYSTIME_TIMER_SLOTS];
+};
+
+
+// initialize wheel, now is time function (systime_ms, systime_tick, ...)
+void systime_timer_wheel_init(struct systime_timer_wheel *wheel, unsigned (*now)(void));
+
+// initialize timer, fcn can be 0 if only systime_timer_pending() is used as flag
+void systime_timer_init(struct systime_timer *timer, systime_timer_fcn fcn, void *arg);
+
+// start timer that expires at absolute time expires, timer is restarted if pending
+void systime_timer_add(struct systime_timer_wheel *wheel, struct systime_timer *timer, unsigned expires);
+
+// start timer that expires interval after now
+void systime_timer_start(struct systime_timer_wheel *wheel, struct systime_timer *timer, unsigned interval);
+
+// stop timer if it is pending
+void systime_timer_cancel(struct systime_timer_wheel *wheel, struct systime_timer *timer);
+
+// run functions of all expired timers
+void systime_timer_poll(struct systime_timer_wheel *wheel);
+
+// returned by systime_timer_next() if there is no pending timer
+#define SYSTIME_TIMER_NONE (~0U)
+
+/*
+    returns time until first pending timer expires, 0 if some timer is already due
+    or SYSTIME_TIMER_NONE if there are no pending timers.
+    Use it to sleep until next deadline instead of polling.
+*/
+unsigned systime_timer_next(struct systime_timer_wheel *wheel);
+
+// true if timer is started and not yet expired
+#define systime_timer_pending(timer) ((timer)->pprev != 0)
+
+
+
+#ifdef __cplusplus
+}
+#endif // _cplusplus
+
+#endif // __SYSTIME_TIMER_H__
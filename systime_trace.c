@@ -0,0 +1,240 @@
+// systime_trace.c
+
+#include "systime_trace.h"
+#include "systime_sync.h"
+
+
+#define TRACE_MASK (SYSTIME_TRACE_SIZE - 1)
+
+
+
+// writes value as variable length integer, returns number of bytes
+static unsigned put_var(unsigned char *p, unsigned long long value)
+{
+    unsigned n = 0;
+
+    while(value >= 0x80)
+    {
+        p[n++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    p[n++] = (unsigned char)value;
+
+    return n;
+}
+
+
+
+// reads variable length integer of at most max bytes, returns number of bytes or 0 if it is incomplete
+static unsigned get_var(const unsigned char *p, unsigned len, unsigned max, unsigned long long *value)
+{
+    unsigned long long v = 0;
+    unsigned n;
+
+    for(n = 0; n < len && n < max; n++)
+    {
+        v |= (unsigned long long)(p[n] & 0x7F) << (7 * n);
+        if(!(p[n] & 0x80))
+        {
+            *value = v;
+            return n + 1;
+        }
+    }
+
+    return 0;
+}
+
+
+
+static void trace_put(struct systime_trace *trace, unsigned code, unsigned arg)
+{
+    unsigned char rec[SYSTIME_TRACE_RECORD_MAX];
+    unsigned head = trace->head;
+    unsigned long long delta;
+    unsigned n, i;
+
+    // 32-bit time is extended by its delta, so interval must be less than its period
+    if(trace->now64) delta = trace->now64() - trace->last;
+    else delta = (unsigned)(trace->now() - (unsigned)trace->last);
+
+    // lowest bit of event code tells if argument follows
+    n = put_var(rec, delta);
+    n += put_var(rec + n, code);
+    if(code & 1) n += put_var(rec + n, arg);
+
+    if(SYSTIME_TRACE_SIZE - (head - systime_sync_load(&trace->tail)) < n)
+    {
+        trace->dropped++;
+        return;
+    }
+
+    // consumer finished reading bytes before tail, they can be overwritten
+    systime_sync_acquire();
+    for(i = 0; i < n; i++) trace->buf[(head + i) & TRACE_MASK] = rec[i];
+    trace->last += delta;
+
+    // publish whole record at once, after its bytes, only producer writes head
+    systime_sync_store_release(&trace->head, head + n);
+}
+
+
+
+// copy up to SYSTIME_TRACE_RECORD_MAX bytes of oldest records to rec, returns number of bytes
+static unsigned trace_peek(struct systime_trace *trace, unsigned char *rec)
+{
+    unsigned tail = trace->tail;
+    unsigned n = systime_sync_load(&trace->head) - tail;
+    unsigned i;
+
+    // bytes before head are written
+    systime_sync_acquire();
+    if(n > SYSTIME_TRACE_RECORD_MAX) n = SYSTIME_TRACE_RECORD_MAX;
+    for(i = 0; i < n; i++) rec[i] = trace->buf[(tail + i) & TRACE_MASK];
+
+    return n;
+}
+
+
+
+//##############################################################################################
+
+
+// initialize empty trace, now is time function (systime_tick, systime_us, ...)
+void systime_trace_init(struct systime_trace *trace, unsigned (*now)(void))
+{
+    trace->now = now;
+    trace->now64 = 0;
+    trace->head = 0;
+    trace->tail = 0;
+    trace->dropped = 0;
+    trace->last = now();
+    trace->read_time = trace->last;
+}
+
+
+
+// initialize empty trace with 64-bit time function (systime_tick64, ...), records can be any time apart
+void systime_trace_init64(struct systime_trace *trace, unsigned long long (*now64)(void))
+{
+    trace->now = 0;
+    trace->now64 = now64;
+    trace->head = 0;
+    trace->tail = 0;
+    trace->dropped = 0;
+    trace->last = now64();
+    trace->read_time = trace->last;
+}
+
+
+
+// record event
+void systime_trace(struct systime_trace *trace, unsigned event)
+{
+    trace_put(trace, event << 1, 0);
+}
+
+
+
+// record event with argument
+void systime_trace_arg(struct systime_trace *trace, unsigned event, unsigned arg)
+{
+    trace_put(trace, (event << 1) | 1, arg);
+}
+
+
+
+// read oldest record to ev, returns 0 if trace is empty
+int systime_trace_next(struct systime_trace *trace, struct systime_trace_event *ev)
+{
+    unsigned char rec[SYSTIME_TRACE_RECORD_MAX];
+    unsigned n = trace_peek(trace, rec);
+
+    if(n == 0) return 0;
+
+    // producer publishes only whole records, so decoding can't fail
+    n = systime_trace_decode(rec, n, &trace->read_time, ev);
+    // bytes are copied before tail frees them, only consumer writes tail
+    systime_sync_store_release(&trace->tail, trace->tail + n);
+
+    return 1;
+}
+
+
+
+/*
+    move whole records to data, at most size bytes, for decoding on host, returns number
+    of bytes. time is set to time before first moved record, start of decoding on host.
+*/
+unsigned systime_trace_read(struct systime_trace *trace, unsigned char *data, unsigned size, unsigned long long *time)
+{
+    unsigned total = 0;
+
+    *time = trace->read_time;
+
+    for(;;)
+    {
+        struct systime_trace_event ev;
+        unsigned long long t = trace->read_time;
+        unsigned char rec[SYSTIME_TRACE_RECORD_MAX];
+        unsigned n = trace_peek(trace, rec);
+        unsigned i;
+
+        if(n == 0) break;
+
+        n = systime_trace_decode(rec, n, &t, &ev);
+        if(total + n > size) break;
+
+        for(i = 0; i < n; i++) data[total + i] = rec[i];
+        total += n;
+        trace->read_time = t;
+        systime_sync_store_release(&trace->tail, trace->tail + n);
+    }
+
+    return total;
+}
+
+
+
+/*
+    decode one record from data of len bytes, time is time of previous record and it
+    is advanced to this one. Returns number of bytes of record or 0 if data is incomplete.
+*/
+unsigned systime_trace_decode(const unsigned char *data, unsigned len, unsigned long long *time, struct systime_trace_event *ev)
+{
+    unsigned long long delta, code, arg = 0;
+    unsigned n, k;
+
+    // delta of 64-bit time can take 10 bytes, event and argument are 32-bit
+    n = get_var(data, len, 10, &delta);
+    if(n == 0) return 0;
+    k = get_var(data + n, len - n, 5, &code);
+    if(k == 0) return 0;
+    n += k;
+
+    if(code & 1)
+    {
+        k = get_var(data + n, len - n, 5, &arg);
+        if(k == 0) return 0;
+        n += k;
+    }
+
+    ev->arg = (unsigned)arg;
+    ev->has_arg = (unsigned)code & 1;
+    ev->event = (unsigned)code >> 1;
+
+    *time += delta;
+    ev->time = *time;
+
+    return n;
+}
+
+
+
+// convert time in ticks to ns, num / den ticks for 1 ms as given to systime_time_init_frac()
+unsigned long long systime_trace_ns(unsigned long long ticks, unsigned num, unsigned den)
+{
+    unsigned long long t = ticks * den;
+    unsigned long long ms = t / num;
+
+    return ms * 1000000ULL + (t - ms * num) * 1000000ULL / num;
+}
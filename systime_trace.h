@@ -0,0 +1,116 @@
+// systime_trace.h
+
+/*
+    Event trace ring buffer with delta encoded timestamps.
+
+    Every record is time since previous record and event number, optionally followed by
+    argument, all as variable length integers (7 bits per byte, LEB128). Events that
+    are less than 128 ticks apart with small event number take two bytes instead of
+    eight of full 32-bit timestamp and event.
+
+    Buffer is lock-free single producer, single consumer ring of SYSTIME_TRACE_SIZE bytes.
+    Producer writes whole records and publishes them with one release store of head, consumer
+    reads them with systime_trace_next() on target or copies them with systime_trace_read()
+    to send them to host, where systime_trace_decode() reconstructs absolute times.
+    When buffer is full new records are dropped and counted.
+
+    Trace works in units of time function passed to systime_trace_init(), for example
+    systime_tick or systime_us. Interval between two records must be less than full
+    unsigned period of that function. With 64-bit time function passed to
+    systime_trace_init64(), for example systime_tick64, interval is not limited, delta
+    of full period or longer takes up to 10 bytes.
+
+    Example:
+    static struct systime_trace trace;
+
+    systime_trace_init(&trace, systime_tick);
+    systime_trace(&trace, EV_RX);
+    systime_trace_arg(&trace, EV_LEN, len);
+
+    while(systime_trace_next(&trace, &ev)) print(ev.time, ev.event, ev.arg);
+
+    systime_trace() and systime_trace_arg() must be called from one context only, or
+    with interrupts disabled if events are traced from several interrupts.
+*/
+
+
+#ifndef __SYSTIME_TRACE_H__
+#define __SYSTIME_TRACE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif // _cplusplus
+
+// size of ring buffer in bytes, must be power of 2
+#if !defined(SYSTIME_TRACE_SIZE)
+#define SYSTIME_TRACE_SIZE 1024
+#endif // SYSTIME_TRACE_SIZE
+
+// maximum size of one record, 64-bit time of 10 bytes, event and argument of 5 bytes each
+#define SYSTIME_TRACE_RECORD_MAX 20
+
+struct systime_trace
+{
+    unsigned (*now)(void);
+    unsigned long long (*now64)(void);
+    // bytes written, only producer changes it
+    unsigned head;
+    // bytes read, only consumer changes it
+    unsigned tail;
+    // time of last written record
+    unsigned long long last;
+    // number of dropped records
+    unsigned dropped;
+    // time of last read record
+    unsigned long long read_time;
+    unsigned char buf[SYSTIME_TRACE_SIZE];
+};
+
+struct systime_trace_event
+{
+    // absolute time, it doesn't wrap
+    unsigned long long time;
+    unsigned event;
+    unsigned arg;
+    // nonzero if record has argument
+    unsigned has_arg;
+};
+
+
+// initialize empty trace, now is time function (systime_tick, systime_us, ...)
+void systime_trace_init(struct systime_trace *trace, unsigned (*now)(void));
+
+// initialize empty trace with 64-bit time function (systime_tick64, ...), records can be any time apart
+void systime_trace_init64(struct systime_trace *trace, unsigned long long (*now64)(void));
+
+// record event, event numbers must be less than 2^31
+void systime_trace(struct systime_trace *trace, unsigned event);
+
+// record event with argument
+void systime_trace_arg(struct systime_trace *trace, unsigned event, unsigned arg);
+
+// read oldest record to ev, returns 0 if trace is empty
+int systime_trace_next(struct systime_trace *trace, struct systime_trace_event *ev);
+
+/*
+    move whole records to data, at most size bytes, for decoding on host, returns number
+    of bytes. time is set to time before first moved record, start of decoding on host.
+*/
+unsigned systime_trace_read(struct systime_trace *trace, unsigned char *data, unsigned size, unsigned long long *time);
+
+/*
+    decode one record from data of len bytes, time is time of previous record and it
+    is advanced to this one. Returns number of bytes of record or 0 if data is incomplete.
+*/
+unsigned systime_trace_decode(const unsigned char *data, unsigned len, unsigned long long *time, struct systime_trace_event *ev);
+
+// convert time in ticks to ns, num / den ticks for 1 ms as given to systime_time_init_frac()
+unsigned long long systime_trace_ns(unsigned long long ticks, unsigned num, unsigned den);
+
+
+
+#ifdef __cplusplus
+}
+#endif // _cplusplus
+
+#endif // __SYSTIME_TRACE_H__